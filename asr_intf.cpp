@@ -25,6 +25,7 @@
 #include "stdtty.hpp"
 
 #include "proc.hpp"
+#include "snapshot.hpp"
 #include "iodev.hpp"
 #include "asr.hpp"
 
@@ -52,6 +53,31 @@ AsrIntf::~AsrIntf() {
   if (asr) delete asr;
 }
 
+/*
+ * Snapshots
+ */
+void AsrIntf::save_state(SnapshotWriter &w) const
+{
+  w.put16(mask);
+  w.put32(data_buf);
+  w.put_bool(ready);
+  w.put_bool(input_pending);
+  w.put_bool(output_mode);
+  w.put_bool(output_pending);
+  w.put8(static_cast<uint8_t>(activity));
+}
+
+void AsrIntf::restore_state(SnapshotReader &r)
+{
+  mask = r.get16();
+  data_buf = r.get32();
+  ready = r.get_bool();
+  input_pending = r.get_bool();
+  output_mode = r.get_bool();
+  output_pending = r.get_bool();
+  activity = static_cast<Activity>(r.get8());
+}
+
 const char *AsrIntf::name() const {
   return "ASR";
 }
@@ -61,6 +61,9 @@ namespace h16 {
 
     void dmc(unsigned dmc_dev, int16_t &data, bool erl);
 
+    void save_state(SnapshotWriter &w) const;
+    void restore_state(SnapshotReader &r);
+
     bool special(char c);
         
     const char *name() const;
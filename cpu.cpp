@@ -22,13 +22,20 @@
 
 #include "cpu.hpp"
 #include "rtc.hpp"
+#include "trace_writer.hpp"
+#include "snapshot.hpp"
 
+#include <algorithm>
+#include <bit>
 #include <cassert>
+#include <cctype>
+#include <cstring>
+#include <format>
 #include <iostream>
+#include <map>
 #include <sstream>
 
 #define CORE_SIZE 32768
-#define TRACE_BUF (1024*1024)
 
 /*****************************************************************
  * Btrace; binary trace (because an earlier one that stored ASCII
@@ -120,15 +127,46 @@ CPU::CPU(bool hasEa)
   /*
    * Initialize the trace buffer
    */
-  btrace_buf.resize(TRACE_BUF);
-  for (auto &t: btrace_buf) {
-    t.v = false;
-  }
-  trace_ptr = 0;
+  trace_mode = TraceMode::OFF;
+  trace_writer = nullptr;
+  set_trace(TraceMode::FULL, DEFAULT_TRACE_ENTRIES);
+
+  write_generation = 0;
+  sector_generation.assign(core_size >> SECTOR_SHIFT, 0);
+
+  idle_length = DEFAULT_IDLE_LENGTH;
+  idle_jump = false;
+  io_generation = 0;
+  idle_skipped = 0;
+  waiting_for_input = false;
+  idle.valid = false;
+
+  engine = Engine::INTERP;
+  decoded.resize(core_size);
+  invalidate_decoded();
+  decoded_ea = 0;
+  decoded_y = 0;
+
+  watch.assign(core_size, 0);
+  io_watch = 0;
+  watch_armed = false;
+  watching = false;
+
+  profiling = false;
+  profile_breaks = ProfileCount();
+  profile_idle_skipped = 0;
+
+  stats = Stats();
+
+  call_tracing = false;
+  call_last = 0;
 
 #ifdef TEST_GENERIC_SKIP
   test_generic_skip();
 #endif
+#ifdef TEST_MULTIPLY_DIVIDE
+  test_multiply_divide();
+#endif
 #ifdef TEST_GENERIC_GROUP_A
   test_generic_group_A();
 #endif
@@ -139,9 +177,10 @@ CPU::CPU(bool hasEa)
 }
 
 CPU::~CPU() {
+  (void) close_trace_file();
 }
 
-void CPU::increment_p(uint16_t n) {
+inline void CPU::increment_p(uint16_t n) {
   uint16_t g = ((ea) ?
                 ((p & 0x7fff) | (m & 0x8000)) :
                 ((p & 0x3fff) | (m & 0xc000)));
@@ -177,9 +216,8 @@ void CPU::master_clear() {
 
   start_button_interrupt = false;
   interrupts = 0;
-  rtclk = false;
   dmc_req = 0;
-  melov = false;
+  attention = 0;
 
   run = false;
   fetched = false;
@@ -214,7 +252,12 @@ bool CPU::optimize_io_poll(uint16_t instr) {
      * for keyboard input).
      */
 
+    const uint64_t before = half_cycles;
+
     if ( jump_time_to_event(half_cycles) ) {
+      ++io_generation; // Devices have been called
+      stats.io_poll_jumps++;
+      stats.io_poll_skipped += half_cycles - before;
 
       // rerun the IO command in the hope that
       // it will now skip the JMP *-1
@@ -224,34 +267,12 @@ bool CPU::optimize_io_poll(uint16_t instr) {
 
       io_polling(instr);
 
-        
-      // There are no events pending
-      //
-      // Are we waiting on the ASR for input?
-      //
-      // We could wait for keyboard input
-      // at this point, however this won't
-      // work for the case that there is a GUI
-      // frontpanel since that needs to be
-      // serviced too.
-      //
-      // Ideally we should return to the
-      // GUI code, remove the idle procedure
-      // and wait until a GUI event or keyboard
-      // input occurs before reinvoking the
-      // call to the kernel.
-      //
-      // However, this is a bit complicated
-      // so for now just let it poll the
-      // device
-        
-      if ((instr & 077) == static_cast<unsigned>(IoDevice::ASR)) {
-        // Ought to wait for keyboard or GUI
-        // printf("Polling ASR\n");
-      } else {
-        // Do something about apparent infinite
-        // loop?
-      }
+      // There are no events pending, so only outside input
+      // (ASR keyboard, start button) can end the loop. The
+      // idle loop detection (see skip_idle()) sees the
+      // JMP *-1 come round to the same state and run_until()
+      // then returns WAIT so the host can block until there
+      // is some.
     }
 
     //
@@ -260,14 +281,91 @@ bool CPU::optimize_io_poll(uint16_t instr) {
     // be taken instead, similarly for a DMC break or
     // memory lockout violation
     //
-    if ((pi && (interrupts || start_button_interrupt)) ||
-        dmc_req || melov)
+    if (break_pending())
       r = 0;
   }
 
   return r;
 }
 
+/*****************************************************************
+ * Idle loop skipping
+ *
+ * Called at the top of the run loop after a short backward JMP.
+ * The first time round the state is noted; if the next time
+ * round it is exactly the same (same place, registers and keys,
+ * no memory written, no I/O done and no break about to be taken)
+ * then the loop can only be left by something from outside the
+ * CPU, which cannot happen before idle_deadline(). Skip as many
+ * whole trips as fit before then (and in the instruction count),
+ * leaving the last part-trip to run as normal so that the run
+ * loop stops exactly where it would have done. If nothing is ever
+ * going to happen, skip to the deadline and say that the machine
+ * is waiting for input.
+ *****************************************************************/
+uint16_t CPU::idle_keys() {
+  return ((c << 0) | (pi << 1) | (ml << 2) | (ea << 3) | (dp << 4) |
+          (pi_pending << 5) | (ml_pending << 6) | (ea_disable << 7) |
+          (pmi << 8) | (melov_pending << 9) | (run << 10));
+}
+
+uint64_t CPU::skip_idle(uint64_t count, uint64_t deadline) {
+  const uint16_t keys = idle_keys();
+
+  idle_jump = false;
+
+  /*
+   * Each trip round counts towards hits, and half_cycles can only
+   * be watched trip by trip, while there are conditions
+   */
+  const bool no_conditions = (!watching) || conditions.empty();
+
+  if (idle.valid && no_conditions && (!break_flag) && fetched &&
+      (idle.p == p) && (idle.keys == keys) &&
+      (idle.a == a) && (idle.b == b) && (idle.x == x) &&
+      (idle.sc == sc) && (idle.j == j) &&
+      (idle.write_generation == write_generation) &&
+      (idle.io_generation == io_generation) &&
+      (idle.count > count) && (idle.half_cycles < half_cycles)) {
+
+    const uint64_t period = half_cycles - idle.half_cycles;
+    const uint64_t instrs = idle.count - count;
+    uint64_t limit = idle_deadline(deadline);
+
+    if (limit == UINT64_MAX) {
+      waiting_for_input = true;
+      limit = deadline;
+    }
+
+    if ((half_cycles < deadline) && (half_cycles < limit)) {
+      const uint64_t n = std::min((limit - half_cycles - 1) / period,
+                                  (count - 1) / instrs);
+      half_cycles  += n * period;
+      idle_skipped += n * period;
+      count        -= n * instrs;
+      if (n) {
+        stats.idle_skips++;
+        stats.idle_skipped += n * period;
+      }
+    }
+  }
+
+  idle.valid = true;
+  idle.p = p;
+  idle.keys = keys;
+  idle.a = a;
+  idle.b = b;
+  idle.x = x;
+  idle.sc = sc;
+  idle.j = j;
+  idle.half_cycles = half_cycles;
+  idle.write_generation = write_generation;
+  idle.io_generation = io_generation;
+  idle.count = count;
+
+  return count;
+}
+
 /*****************************************************************
  * Add setting the carry bit to overflow
  * Weird, I know but that's the way it works on a series 16
@@ -315,7 +413,63 @@ int16_t CPU::short_adc(int16_t a, int16_t m, bool &c) {
   return r;
 }
 
+/*****************************************************************
+ * Multiply and divide
+ *
+ * The hardware does these a step at a time, as modelled by
+ * multiply_microcode() and divide_microcode(). All that is visible
+ * at the end though is the result, what is left in the shift
+ * count and (for divide) the time taken, and these can be worked
+ * out directly. test_multiply_divide() checks that the two agree.
+ *****************************************************************/
+
+/*
+ * A*M; the product is left in A (high 16 bits) and B (low 15 bits,
+ * sign position clear). The multiply steps two bits at a time,
+ * shifting B right, so the shift count is left with product bits
+ * 0 to 3 above multiplier bits 14 and 15.
+ */
 int32_t CPU::multiply(int16_t &ra, int16_t &rb, int16_t rm, int16_t &sc) {
+  const int32_t p = int32_t(ra) * int32_t(rm);
+
+  sc = ((p & 0xf) << 2) | ((uint16_t(ra) >> 14) & 3);
+  ra = p >> 15;
+  rb = p & 0x7fff;
+
+  return p;
+}
+
+/*
+ * AB/M; quotient to A, remainder (with the sign of the dividend)
+ * to B and its low bits to the shift count. Takes an extra cycle
+ * to correct the remainder when the dividend is negative, the
+ * quotient odd and the remainder not zero. Divide by zero and
+ * overflow (including a quotient of -32768) leave results that are
+ * best got from the microcode.
+ */
+unsigned CPU::divide(int16_t &ra, int16_t &rb, int16_t rm, int16_t &sc, bool &cbitf) {
+  const int32_t dividend = (int32_t(ra) * 32768) + (rb & 0x7fff);
+
+  if (rm != 0) {
+    const int32_t q = dividend / rm;
+    const int32_t r = dividend % rm;
+
+    if ((q >= -32767) && (q <= 32767)) {
+      const bool correct = ((dividend < 0) && ((q & 1) != 0) && (r != 0));
+
+      ra = q;
+      rb = r;
+      sc = r & 0x3f;
+      cbitf = false;
+
+      return (correct) ? 20 : 19;
+    }
+  }
+
+  return divide_microcode(ra, rb, rm, sc, cbitf);
+}
+
+int32_t CPU::multiply_microcode(int16_t &ra, int16_t &rb, int16_t rm, int16_t &sc) {
   int m = rm;
   int a = ra;
   int b = rb;
@@ -413,7 +567,7 @@ int32_t CPU::multiply(int16_t &ra, int16_t &rb, int16_t rm, int16_t &sc) {
   return p;
 }
 
-unsigned CPU::divide(int16_t &ra, int16_t &rb, int16_t rm, int16_t &sc, bool &cbitf) {
+unsigned CPU::divide_microcode(int16_t &ra, int16_t &rb, int16_t rm, int16_t &sc, bool &cbitf) {
   int d, e;
   bool azzzz, a00ff, m01ff, d01ff, remok;
   bool e00dj;
@@ -571,6 +725,54 @@ unsigned CPU::divide(int16_t &ra, int16_t &rb, int16_t rm, int16_t &sc, bool &cb
   return count+1;
 }
 
+#ifdef TEST_MULTIPLY_DIVIDE
+/*
+ * Exhaustive check of multiply() and divide() against the microcode,
+ * over every A and M (for divide, with B varying as well). Slow.
+ */
+void CPU::test_multiply_divide() {
+  long problems = 0;
+
+  for (uint64_t i=0; i<0x100000000ull; i++) {
+    const int16_t a0 = i >> 16;
+    const int16_t m = i & 0xffff;
+    const int16_t b0 = (i * 0x9e3779b9u) >> 16;
+
+    int16_t a1 = a0, b1 = b0, sc1 = 0;
+    int16_t a2 = a0, b2 = b0, sc2 = 0;
+    bool c1 = false, c2 = false;
+
+    int32_t p1 = multiply(a1, b1, m, sc1);
+    int32_t p2 = multiply_microcode(a2, b2, m, sc2);
+
+    if ((p1 != p2) || (a1 != a2) || (b1 != b2) || (sc1 != sc2)) {
+      if (problems++ < 20)
+        fprintf(stderr, "MPY a=%06o m=%06o: a=%06o b=%06o sc=%02o  ucode: a=%06o b=%06o sc=%02o\n",
+                a0 & 0xffff, m & 0xffff, a1 & 0xffff, b1 & 0xffff, sc1,
+                a2 & 0xffff, b2 & 0xffff, sc2);
+    }
+
+    a1 = a2 = a0;
+    b1 = b2 = b0;
+    unsigned h1 = divide(a1, b1, m, sc1, c1);
+    unsigned h2 = divide_microcode(a2, b2, m, sc2, c2);
+
+    if ((h1 != h2) || (a1 != a2) || (b1 != b2) || (sc1 != sc2) || (c1 != c2)) {
+      if (problems++ < 20)
+        fprintf(stderr, "DIV a=%06o b=%06o m=%06o: a=%06o b=%06o sc=%02o c=%d %u  ucode: a=%06o b=%06o sc=%02o c=%d %u\n",
+                a0 & 0xffff, b0 & 0xffff, m & 0xffff,
+                a1 & 0xffff, b1 & 0xffff, sc1, c1, h1,
+                a2 & 0xffff, b2 & 0xffff, sc2, c2, h2);
+    }
+  }
+
+  if (problems) {
+    fprintf(stderr, "%s: %ld problems\n", __PRETTY_FUNCTION__, problems);
+    exit(1);
+  }
+}
+#endif
+
 /*****************************************************************
  * set the X register
  * Location "zero" in core tracks this, so the m and y registers
@@ -583,12 +785,323 @@ void CPU::set_x(uint16_t n) {
   m = n;
   y = j;
   core[j] = n;
+  decoded[j & addr_mask].flags = 0;
+  sector_generation[(j & addr_mask) >> SECTOR_SHIFT] = ++write_generation;
 }
 
 void CPU::set_just_x(uint16_t n) {
   x = n;
 }
 
+void CPU::deposit(uint16_t addr, uint16_t data) {
+  uint16_t ma = addr & addr_mask;
+
+  core[ma] = data;
+  modified[ma] = 1;
+  decoded[ma].flags = 0;
+  sector_generation[ma >> SECTOR_SHIFT] = ++write_generation;
+
+  if (((addr ^ j) & ((ea) ? 0x7fff : 0x3fff)) == 0) {
+    x = data;
+  }
+}
+
+void CPU::set_halted(uint16_t addr, bool extend) {
+  ea = extend && ea_allowed;
+  run = false;
+  break_flag = false;
+  fetched_p = addr;
+  p = y = addr + 1;
+  m = core[p & addr_mask];
+  fetched = true;
+  op = (c << 8) | (pi << 7) | (ml << 5) | (ea << 4) | (dp << 3);
+}
+
+/*****************************************************************
+ * Profiling
+ *****************************************************************/
+void CPU::set_profile(bool on) {
+  if (on && profile.empty())
+    clear_profile();
+  profiling = on;
+}
+
+void CPU::clear_profile() {
+  profile.assign(addr_mask + 1, ProfileCount());
+  profile_ops.assign(1 << 16, ProfileCount());
+  profile_breaks = ProfileCount();
+  profile_idle_skipped = idle_skipped;
+}
+
+/*****************************************************************
+ * Call graph
+ *****************************************************************/
+void CPU::set_callgraph(bool on) {
+  if (on && call_nodes.empty())
+    clear_callgraph();
+  if (on && !call_tracing)
+    call_last = half_cycles;    // don't charge time spent off
+  else if (call_tracing && !on)
+    call_charge();
+  call_tracing = on;
+}
+
+void CPU::clear_callgraph() {
+  call_nodes.assign(1, CallNode{CALL_ROOT, 0, 1, 0});
+  call_stack.assign(1, 0);
+  call_children.clear();
+  call_last = half_cycles;
+}
+
+void CPU::call_push(uint16_t entry) {
+  call_charge();
+
+  for (size_t i = call_stack.size(); --i > 0; ) {
+    if (call_nodes[call_stack[i]].entry == entry) {
+      call_stack.resize(i);
+      break;
+    }
+  }
+  if (call_stack.size() >= CALL_DEPTH)
+    call_stack.resize(1);
+
+  const uint32_t parent = call_stack.back();
+  auto [it, inserted] =
+    call_children.try_emplace((uint64_t(parent) << 16) | entry,
+                              uint32_t(call_nodes.size()));
+  if (inserted)
+    call_nodes.push_back(CallNode{entry, parent, 0, 0});
+  call_nodes[it->second].calls++;
+  call_stack.push_back(it->second);
+}
+
+void CPU::call_return() {
+  const uint16_t mask = (ea) ? 0x7fff : 0x3fff;
+
+  for (size_t i = call_stack.size(); --i > 0; ) {
+    if (((p ^ core[call_nodes[call_stack[i]].entry]) & mask) == 0) {
+      call_charge();
+      call_stack.resize(i);
+      break;
+    }
+  }
+}
+
+/*****************************************************************
+ * Breakpoints and watchpoints
+ *****************************************************************/
+void CPU::set_watch(uint16_t addr, uint8_t kinds, bool on) {
+  uint8_t &w = watch[addr & addr_mask];
+
+  w = (on) ? (w | kinds) : (w & ~kinds);
+  clear_conditions(addr & addr_mask, kinds);
+  update_watch_armed();
+}
+
+void CPU::set_io_watch(unsigned device, bool on) {
+  const uint64_t bit = uint64_t(1) << (device & 077);
+
+  io_watch = (on) ? (io_watch | bit) : (io_watch & ~bit);
+  clear_conditions(device & 077, WATCH_IO);
+  update_watch_armed();
+}
+
+void CPU::clear_watches(uint8_t kinds) {
+  for (auto &w: watch)
+    w &= ~kinds;
+  if (kinds & WATCH_IO)
+    io_watch = 0;
+  std::erase_if(conditions, [kinds](const auto &c) {
+    return ((c.first >> 16) & kinds) != 0;
+  });
+  update_watch_armed();
+}
+
+void CPU::update_watch_armed() {
+  watch_armed = (io_watch != 0) ||
+    std::any_of(watch.begin(), watch.end(), [](uint8_t w) { return w != 0; });
+}
+
+void CPU::clear_conditions(uint16_t addr, uint8_t kinds) {
+  for (uint8_t k = WATCH_EXEC; k <= WATCH_IO; k <<= 1) {
+    if (kinds & k)
+      conditions.erase(watch_key(k, addr));
+  }
+}
+
+/*
+ * Set one kind of point (a single WATCH_ bit) at addr, or at a
+ * device address for WATCH_IO, that only stops when cond is met
+ */
+void CPU::set_condition(uint16_t addr, uint8_t kind, const Condition &cond) {
+  if (kind == WATCH_IO) {
+    set_io_watch(addr, true);
+    addr &= 077;
+  } else {
+    set_watch(addr, kind, true);
+    addr &= addr_mask;
+  }
+  conditions[watch_key(kind, addr)] = CondWatch{cond, 0};
+}
+
+const CPU::Condition *CPU::get_condition(uint16_t addr, uint8_t kind, uint64_t &hits) {
+  addr &= (kind == WATCH_IO) ? 077 : addr_mask;
+
+  auto it = conditions.find(watch_key(kind, addr));
+  if (it == conditions.end())
+    return nullptr;
+
+  hits = it->second.hits;
+  return &it->second.cond;
+}
+
+/*
+ * field op number [and/or field op number]...
+ */
+bool CPU::parse_condition(const std::string &s, Condition &cond) {
+  static const std::map<std::string, Condition::Field> fields {
+    {"a", Condition::Field::A},
+    {"b", Condition::Field::B},
+    {"x", Condition::Field::X},
+    {"p", Condition::Field::P},
+    {"c", Condition::Field::C},
+    {"keys", Condition::Field::KEYS},
+    {"half_cycles", Condition::Field::HALF_CYCLES},
+    {"hits", Condition::Field::HITS},
+  };
+  static const std::map<std::string, Condition::Op> ops {
+    {"==", Condition::Op::EQ}, {"=", Condition::Op::EQ},
+    {"!=", Condition::Op::NE},
+    {"<", Condition::Op::LT}, {"<=", Condition::Op::LE},
+    {">", Condition::Op::GT}, {">=", Condition::Op::GE},
+  };
+
+  std::vector<std::string> tokens;
+  for (unsigned i = 0; i < s.size(); ) {
+    const unsigned char ch = s[i];
+    unsigned j = i + 1;
+
+    if (std::isspace(ch)) {
+      i++;
+      continue;
+    } else if (std::isalnum(ch) || (ch == '_') || (ch == '\'')) {
+      while ((j < s.size()) && (std::isalnum((unsigned char) s[j]) || (s[j] == '_')))
+        j++;
+    } else {
+      while ((j < s.size()) && std::strchr("=!<>&|", s[j]))
+        j++;
+    }
+
+    std::string t = s.substr(i, j - i);
+    std::transform(t.begin(), t.end(), t.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    tokens.push_back(t);
+    i = j;
+  }
+
+  cond.terms.clear();
+  cond.text.clear();
+
+  bool or_before = false;
+  unsigned i = 0;
+  while ((i + 3) <= tokens.size()) {
+    Condition::Term t;
+    const std::string &n = tokens[i + 2];
+    const char *str = n.c_str() + ((n[0] == '\'') ? 1 : 0);
+    char *end;
+
+    if ((!fields.count(tokens[i])) || (!ops.count(tokens[i + 1])) || (*str == '\0'))
+      return false;
+    t.field = fields.at(tokens[i]);
+    t.op = ops.at(tokens[i + 1]);
+    t.or_before = or_before;
+    t.value = std::strtoull(str, &end, (n[0] == '\'') ? 8 : 0);
+    if (*end != '\0')
+      return false;
+
+    cond.terms.push_back(t);
+    cond.text += std::format("{}{} {} {}", (cond.text.empty()) ? "" :
+                             (or_before) ? " or " : " and ",
+                             tokens[i], tokens[i + 1], n);
+    i += 3;
+
+    if (i == tokens.size())
+      return true;
+
+    const std::string &conj = tokens[i++];
+    if ((conj == "and") || (conj == "&&")) {
+      or_before = false;
+    } else if ((conj == "or") || (conj == "||")) {
+      or_before = true;
+    } else {
+      return false;
+    }
+  }
+
+  return false;
+}
+
+bool CPU::condition_met(CondWatch &w) {
+  bool r = true;
+
+  w.hits++;
+
+  for (const auto &t: w.cond.terms) {
+    if (t.or_before) {
+      if (r)
+        return true;
+      r = true;
+    } else if (!r) {
+      continue; // The rest of this clause can't matter
+    }
+
+    uint64_t v = 0;
+    switch (t.field) {
+    case Condition::Field::A:    v = uint16_t(a); break;
+    case Condition::Field::B:    v = uint16_t(b); break;
+    case Condition::Field::X:    v = uint16_t(x); break;
+    case Condition::Field::P:    v = p & addr_mask; break;
+    case Condition::Field::C:    v = c; break;
+    case Condition::Field::KEYS:
+      v = (c << 15) | (dp << 14) | (pmi << 13) | (sc & 0x3f);
+      break;
+    case Condition::Field::HALF_CYCLES: v = half_cycles; break;
+    case Condition::Field::HITS: v = w.hits; break;
+    }
+
+    switch (t.op) {
+    case Condition::Op::EQ: r = (v == t.value); break;
+    case Condition::Op::NE: r = (v != t.value); break;
+    case Condition::Op::LT: r = (v <  t.value); break;
+    case Condition::Op::LE: r = (v <= t.value); break;
+    case Condition::Op::GT: r = (v >  t.value); break;
+    case Condition::Op::GE: r = (v >= t.value); break;
+    }
+  }
+
+  return r;
+}
+
+void CPU::watch_access(uint8_t kind, uint16_t addr, uint16_t data) {
+  WatchHit hit;
+
+  if (kind != WATCH_IO)
+    addr &= addr_mask;
+
+  if (!conditions.empty()) {
+    auto it = conditions.find(watch_key(kind, addr));
+    if ((it != conditions.end()) && (!condition_met(it->second)))
+      return;
+  }
+
+  hit.kind = kind;
+  hit.addr = addr;
+  hit.data = data;
+  hit.p = ((kind == WATCH_EXEC) ? p : fetched_p) & addr_mask;
+  hit.dmc = dmc_cyc;
+  watch_hit(hit);
+}
+
 /*****************************************************************
  * Set or clear one bit of the "interrupts" variable
  * Used by the devices to generate or clear interrupt
@@ -596,15 +1109,17 @@ void CPU::set_just_x(uint16_t n) {
  *****************************************************************/
 void CPU::set_interrupt(uint16_t bit) {
   interrupts |= bit;
+  update_interrupt_attention();
 }
 
 void CPU::clear_interrupt(uint16_t bit) {
   interrupts &= (~bit);
+  update_interrupt_attention();
 }
 
 void CPU::set_break(unsigned n, bool v) {
   if (n == 0) {
-    rtclk = v;
+    attention = (attention & ~ATTN_RTCLK) | (v ? ATTN_RTCLK : 0);
   } else if (n <= 16) {
     uint16_t m = (1 << (n-1));
     if (v) {
@@ -612,6 +1127,7 @@ void CPU::set_break(unsigned n, bool v) {
     } else {
       dmc_req &= ~m;
     }
+    attention = (attention & ~ATTN_DMC) | (dmc_req ? ATTN_DMC : 0);
   } else {
     std::cerr << "Unexpected set_break()" << std::endl;
     exit(1);
@@ -634,15 +1150,86 @@ void CPU::mem_access(bool p_not_pp1, bool store) {
   fetched = false;
 }
 
-uint16_t CPU::e_a(uint16_t instr) { // Compute effective address
+/*****************************************************************
+ * Effective address
+ *
+ * Specialised on whether the CPU has extended addressing at all
+ * (if not, it behaves as if always in extended mode). Instructions
+ * that are not indirect, the great majority, are done in a few
+ * lines; indirect chains go round the general loop.
+ *****************************************************************/
+template<bool EA_ALLOWED>
+inline uint16_t CPU::e_a_t(uint16_t instr) {
+  uint16_t d;
+
+  m = instr;
+
+  if (decoded_ea) {
+    // Mode already decoded by the BLOCK engine
+    const uint8_t f = decoded_ea;
+    decoded_ea = 0;
+
+    if (f == D_DIRECT) {
+      // Direct current-sector address
+      y = (fetched_p & 0xfe00) | decoded_y;
+      return y;
+    }
+
+    if (f & D_INDIRECT)
+      return e_a_indirect<EA_ALLOWED>();
+
+    const bool ext = ((!EA_ALLOWED) || ea);
+
+    d = decoded_y;
+    if (f & D_SECTOR_ZERO)
+      d |= ((ext) ? (j & 0x7e00) : ((j & 0x3e00) | (fetched_p & 0x4000)));
+    else
+      d |= (fetched_p & 0xfe00);
+
+    if (f & D_INDEXED)
+      d += x;
+
+    y = (ext) ? d : ((d & 0xbfff) | (fetched_p & 0x4000));
+    return y;
+  }
+
+  if (instr & 0x8000)
+    return e_a_indirect<EA_ALLOWED>();
+
+  const bool ext = ((!EA_ALLOWED) || ea);
+
+  if (instr & 0x0200)
+    d = ((fetched_p & 0xfe00) | (instr & 0x01ff));
+  else if (ext)
+    d = ((j & 0x7e00) | (instr & 0x01ff));
+  else
+    d = ((j & 0x3e00) | (instr & 0x01ff)) | (fetched_p & 0x4000);
+
+  if (instr & 0x4000)
+    d += x;
+
+  y = (ext) ? d : ((d & 0xbfff) | (fetched_p & 0x4000));
+  return y;
+}
+
+inline uint16_t CPU::e_a(uint16_t instr) { // Compute effective address
+  return (ea_allowed) ? e_a_t<true>(instr) : e_a_t<false>(instr);
+}
+
+/*
+ * The general case, following a chain of indirect addresses
+ * (the instruction is in m)
+ */
+template<bool EA_ALLOWED>
+uint16_t CPU::e_a_indirect() {
   uint16_t d;
   bool sec_zero;
   bool indirect;
   bool indexing;
   bool first = true;
   unsigned int indirect_count = 8;
-  
-  m = instr;
+  const bool ext = ((!EA_ALLOWED) || ea);
+
   y = fetched_p; // Address of instr (i.e. before increment)
 
   sec_zero = ((m & 0x0200) == 0);
@@ -652,12 +1239,12 @@ uint16_t CPU::e_a(uint16_t instr) { // Compute effective address
     indirect = ((m & 0x8000) != 0);
 
     if (ml && (indirect_count == 0)) {
-      melov = true;
+      set_melov(true);
       indirect = false;
     }
     
     if (sec_zero) {
-      if (ea || (!ea_allowed))
+      if (ext)
         d = ((j & 0x7e00) | (m & 0x81ff));
       else
         d = ((j & 0x3e00) | (m & 0x81ff)) | (fetched_p & 0x4000);
@@ -665,7 +1252,7 @@ uint16_t CPU::e_a(uint16_t instr) { // Compute effective address
       if (first)
         d = ((y & 0xfe00) | (m & 0x01ff));
       else {
-        if (ea || (!ea_allowed))
+        if (ext)
           d = m;
         else
           d = (m & 0xbfff) | (fetched_p & 0x4000);
@@ -677,7 +1264,7 @@ uint16_t CPU::e_a(uint16_t instr) { // Compute effective address
          (!indirect))) // and when no more indirection
       d += x;
 
-    if (ea || (!ea_allowed))
+    if (ext)
       y = d;
     else
       y = (d & 0xbfff) | (y & 0x4000);
@@ -713,6 +1300,9 @@ void CPU::write(uint16_t addr, int16_t data) {
 
   uint16_t ma = addr & addr_mask;
 
+  if (watching && (watch[ma] & WATCH_WRITE))
+    watch_access(WATCH_WRITE, addr, data);
+
   if (((addr ^ j) & ((ea) ? 0x7fff : 0x3fff)) == 0) {
     x = data;
   }
@@ -726,6 +1316,8 @@ void CPU::write(uint16_t addr, int16_t data) {
   if (((ma == 0) || (ma >= 020)) && (!prot)) {
     core[ma] = data;
     modified[ma] = 1;
+    decoded[ma].flags = 0; // no longer the instruction decoded
+    sector_generation[ma >> SECTOR_SHIFT] = ++write_generation;
     if (wrts < 2) {
       wrt_addr[wrts] = ma;
       wrt_data[wrts] = data;
@@ -737,6 +1329,15 @@ void CPU::write(uint16_t addr, int16_t data) {
   //  printf("Write %06o @ %06o\n", data & 0xffff, addr&0xffff );
 }
 
+void CPU::poke(uint16_t addr, uint16_t data) {
+  const int16_t saved_m = m;
+  const uint16_t saved_y = y;
+
+  write(addr, data);
+  m = saved_m;
+  y = saved_y;
+}
+
 int CPU::get_wrt_info(uint16_t addr[2], uint16_t data[2]) {
   int r = wrts;
   int i;
@@ -748,6 +1349,24 @@ int CPU::get_wrt_info(uint16_t addr[2], uint16_t data[2]) {
   return r;
 }
 
+/*
+ * Has anything between first and last been written since
+ * write generation "generation"? (Answered a sector at a time,
+ * so may be true for a write just outside the range.)
+ */
+bool CPU::changed_since(uint64_t generation, uint16_t first, uint16_t last)
+{
+  unsigned s;
+
+  for (s = (first & addr_mask) >> SECTOR_SHIFT;
+       s <= unsigned((last & addr_mask) >> SECTOR_SHIFT); s++) {
+    if (sector_generation[s] > generation)
+      return true;
+  }
+
+  return false;
+}
+
 std::string CPU::dis() {
   uint16_t instr = core[p];
   return instr_table.disassemble(p, instr, 0);
@@ -788,7 +1407,7 @@ void CPU::do_IMA(uint16_t instr) {
   write(yy, a);
   a = mm;
   if (melov_pending) {
-    melov = true; // Occurs immediately
+    set_melov(true); // Occurs immediately
   }
 }
 
@@ -833,7 +1452,7 @@ void CPU::do_OTK(uint16_t instr [[maybe_unused]]) {
     if (sks(instr) != IoStatus::WAIT) {
       increment_p();
     }
-    melov = true;
+    set_melov(true);
   } else {
     c = (a & 0x8000) != 0;
     dp = (a & 0x4000) != 0;
@@ -866,7 +1485,7 @@ void CPU::do_STA(uint16_t instr) {
     addr |= 1;
     write(addr, b);
     if (melov_pending) {
-      melov = true; // Occurs immediately
+      set_melov(true); // Occurs immediately
     }
   }
 }
@@ -1188,8 +1807,11 @@ void CPU::do_INA(uint16_t instr) {
   half_cycles += 2;
   bool rerun = false;
 
+  watch_io(instr);
+
   do {
     if (ina(instr, d) != IoStatus::WAIT) {
+      ++io_generation;
       increment_p();
       if (ml) {
         a = ~0;
@@ -1205,17 +1827,19 @@ void CPU::do_INA(uint16_t instr) {
   } while (rerun);
   
   if (ml) {
-    melov = true;
+    set_melov(true);
   }
 }
 
 void CPU::do_OCP(uint16_t instr [[maybe_unused]]) {
   half_cycles+=2;
+  ++io_generation;
+  watch_io(instr);
   if (ml) {
     if (sks(instr) != IoStatus::WAIT) {
       increment_p();
     }
-    melov = true;
+    set_melov(true);
   } else {
     ocp(instr);
   }
@@ -1224,9 +1848,11 @@ void CPU::do_OCP(uint16_t instr [[maybe_unused]]) {
 void CPU::do_OTA(uint16_t instr [[maybe_unused]]) {
   bool rerun = false;
   half_cycles+=2;
+  watch_io(instr);
 
   do {
     if (((ml) ? sks(instr) : ota(instr, a)) != IoStatus::WAIT) {
+      ++io_generation;
       increment_p();
       rerun = false;
     } else {
@@ -1235,12 +1861,14 @@ void CPU::do_OTA(uint16_t instr [[maybe_unused]]) {
   } while (rerun);
   
   if (ml) {
-    melov = true;
+    set_melov(true);
   }
 }
 
 void CPU::do_SMK(uint16_t instr) {
   half_cycles+=2;
+  ++io_generation;
+  watch_io(instr);
   if (ml) {
     /*
      * The PRM claims that in memory locakout mode all I/O instructions
@@ -1249,7 +1877,7 @@ void CPU::do_SMK(uint16_t instr) {
      * is not affected by being in ML mode. SMK therefore behaves
      * like a NOP.
      */
-    melov = true;
+    set_melov(true);
   } else {
     unsigned int function = (instr >> 6) & 0x0f;
     if ((instr & 0x3f) == 020) {
@@ -1278,6 +1906,7 @@ void CPU::do_SMK(uint16_t instr) {
 void CPU::do_SKS(uint16_t instr [[maybe_unused]]) {
   bool rerun = 0;
   half_cycles+=2;
+  watch_io(instr);
 
   do {
     if (sks(instr) != IoStatus::WAIT) {
@@ -1288,7 +1917,7 @@ void CPU::do_SKS(uint16_t instr [[maybe_unused]]) {
   } while (rerun);
 
   if (ml) {
-    melov = true;
+    set_melov(true);
   }
 }
 
@@ -1336,7 +1965,7 @@ void CPU::do_IRS(uint16_t instr) {
   } else {
     increment_p((d==0) ? 1 : 0);
     if (melov_pending) {
-      melov = true; // Occurs immediately
+      set_melov(true); // Occurs immediately
     }
   }
   if ((d == 0) && break_flag && (break_addr = 061)) {
@@ -1353,11 +1982,17 @@ void CPU::do_JMP(uint16_t instr) {
   if ((new_p & addr_mask) == ((fetched_p-1) & addr_mask))
     jmp_self_minus_one = true;
 
+  if (uint16_t(fetched_p - new_p) < idle_length)
+    idle_jump = true;
+
   p = (((ea) || (!ea_allowed)) ? new_p :
        ((new_p & 0xbfff) | (fetched_p & 0x4000)));
 
   if (ea_disable)
     ea = ea_disable = false;
+
+  if (call_tracing && (instr & 0x8000))
+    call_return();
 }
 
 void CPU::do_JST(uint16_t instr) {
@@ -1378,11 +2013,13 @@ void CPU::do_JST(uint16_t instr) {
 
   write(yy, return_addr);
   p = yy+1;
+  if (call_tracing)
+    call_push(yy & addr_mask);
   if (break_flag) {
     melov_pending = false; // Ignore memory lockout mode
   } else {
     if (melov_pending) {
-      melov = true; // Occurs immediately
+      set_melov(true); // Occurs immediately
     }
   }
 }
@@ -1884,54 +2521,218 @@ void CPU::test_generic_skip() {
 }
 #endif
 
-void CPU::generic_group_A(uint16_t instr) {
-  // first break the instruction into bits
-  bool M[17];
-  int i;
+/*
+ * Group A control signals
+ *
+ * What a Group A instruction does depends only on its low nine
+ * bits (M8 to M16), so the control signals the microcode raises
+ * are worked out at compile time for each of the 512 combinations.
+ * The adder may make a second pass (with AZZZZ set) and C may
+ * enable the carry in, so those are left to generic_group_A().
+ */
+namespace h16 {
 
-  for (i=0; i<16; i++)
-    M[16-i] = (instr >> i) & 1;
-  M[0] = false; // (unused)
+  struct GroupASignals {
+    uint8_t pass[2]; // adder controls for the first and second pass
+    bool twice;      // AZZZZ: make a second pass
+    uint16_t t4;     // T4 controls
+  };
 
-  bool azzzz = false;
+  // Adder controls
+  static constexpr uint8_t GA_EASBM   = 0x01;
+  static constexpr uint8_t GA_JAMKN   = 0x02;
+  static constexpr uint8_t GA_EASTL   = 0x04;
+  static constexpr uint8_t GA_EIK17   = 0x08; // carry in
+  static constexpr uint8_t GA_EIK17_C = 0x10; // carry in if C set
+
+  // T4 controls
+  static constexpr uint16_t GA_CLATR = 0x0001;
+  static constexpr uint16_t GA_CLA1R = 0x0002;
+  static constexpr uint16_t GA_EDAHS = 0x0004;
+  static constexpr uint16_t GA_EDALS = 0x0008;
+  static constexpr uint16_t GA_ETAHS = 0x0010;
+  static constexpr uint16_t GA_ETALS = 0x0020;
+  static constexpr uint16_t GA_EDA1R = 0x0040;
+  static constexpr uint16_t GA_OVERFLOW_TO_C = 0x0080;
+  static constexpr uint16_t GA_SET_C   = 0x0100;
+  static constexpr uint16_t GA_D1_TO_C = 0x0200;
+
+  static consteval uint8_t group_A_pass(const bool M[17], bool azzzz)
+  {
+    bool EASBM = (M[9] || M[11] || azzzz);
+    bool JAMKN = ((M[12] || M[16]) && (!azzzz));
+    bool EASTL = (JAMKN) || (EASBM);
+    // EIK17 = (M[15] && (c || (!M[13])) && (!JAMKN))
+    bool EIK17 = (M[15] && (!M[13]) && (!JAMKN));
+    bool EIK17_C = (M[15] && M[13] && (!JAMKN));
+
+    return (((EASBM) ? GA_EASBM : 0) |
+            ((JAMKN) ? GA_JAMKN : 0) |
+            ((EASTL) ? GA_EASTL : 0) |
+            ((EIK17) ? GA_EIK17 : 0) |
+            ((EIK17_C) ? GA_EIK17_C : 0));
+  }
 
-  bool EASTL, EASBM, JAMKN, EIK17;
+  static consteval std::array<GroupASignals, 512> build_group_A_signals()
+  {
+    std::array<GroupASignals, 512> t {};
+
+    for (unsigned instr = 0; instr < 512; instr++) {
+      bool M[17] = {};
+      for (unsigned i=0; i<9; i++)
+        M[16-i] = (instr >> i) & 1;
+
+      GroupASignals &g = t[instr];
+      g.pass[0] = group_A_pass(M, false);
+      g.pass[1] = group_A_pass(M, true);
+      g.twice = (M[8] && M[15]);
+
+      bool CLATR = (M[11] || M[15] || M[16]);
+      bool CLA1R = (M[10] || M[14]);
+      bool EDAHS = ((M[11] && M[14]) || M[15] || M[16]);
+      bool EDALS = ((M[11] && M[13]) || M[15] || M[16]);
+      bool ETAHS = (M[9] && M[11]);
+      bool ETALS = (M[10] && M[11]);
+      bool EDA1R = ((M[8] && M[10]) || M[14]);
+      bool overflow_to_c = (M[9] && (!M[11]));
+      bool set_c = (M[8] && M[9]);
+      bool d1_to_c = (M[10] && M[12]);
+
+      g.t4 = (((CLATR) ? GA_CLATR : 0) |
+              ((CLA1R) ? GA_CLA1R : 0) |
+              ((EDAHS) ? GA_EDAHS : 0) |
+              ((EDALS) ? GA_EDALS : 0) |
+              ((ETAHS) ? GA_ETAHS : 0) |
+              ((ETALS) ? GA_ETALS : 0) |
+              ((EDA1R) ? GA_EDA1R : 0) |
+              ((overflow_to_c) ? GA_OVERFLOW_TO_C : 0) |
+              ((set_c) ? GA_SET_C : 0) |
+              ((d1_to_c) ? GA_D1_TO_C : 0));
+    }
+
+    return t;
+  }
+
+  static constexpr std::array<GroupASignals, 512> group_A_signals =
+    build_group_A_signals();
+}
+
+void CPU::generic_group_A(uint16_t instr) {
+  const GroupASignals &g = group_A_signals[instr & 0777];
   int16_t s1, s2, s=0;
-  bool v;
+  bool v=false;
   int d;
-  bool CLATR, CLA1R, EDAHS, EDALS, ETAHS, ETALS, EDA1R;
-  bool overflow_to_c, set_c, d1_to_c;
 
-  do {
+  for (int pass = 0; pass < ((g.twice) ? 2 : 1); pass++) {
+    const uint8_t ctl = g.pass[pass];
+
     // T2
-    if (azzzz) {
+    if (pass) {
       a = s & 0xffff;
       half_cycles++;
     }
 
     // tlate
+    s1 = (ctl & GA_EASTL) ? a : 0;
+    s2 = (ctl & GA_EASBM) ? 0 : 0xffff;
 
-    EASBM = (M[9] || M[11] || azzzz);
-    JAMKN = ((M[12] || M[16]) && (!azzzz));
-    EASTL = (JAMKN) || (EASBM);
-
-    //      EIK17 = ((M[15] || (c && (!M[13]))) && (!JAMKN));
-    EIK17 = (M[15] && (c || (!M[13])) && (!JAMKN));
-
-    s1 = (EASTL) ? a : 0;
-    s2 = (EASBM) ? 0 : 0xffff;
-
-    if (JAMKN) {
+    if (ctl & GA_JAMKN) {
       s = s1 ^ s2;
       v=0;
       (void) short_adc((s1 & 0x8000), (s2 & 0x8000), v);
     } else {
-      v = EIK17;
+      v = ((ctl & GA_EIK17) || ((ctl & GA_EIK17_C) && c));
       s = short_adc(s1, s2, v);
     }
+  }
 
-    // T3
-    d = 0xffff; // Due to CLDTR
+  // T3
+  d = 0xffff; // Due to CLDTR
+  d &= s;     // Due to ESTDS
+
+  // T4
+  if (g.t4 & GA_CLATR) // clear A register
+    a = 0;
+  if (g.t4 & GA_CLA1R) // clear A1 register
+    a &= 0x7fff;
+
+  if (g.t4 & GA_EDAHS) // enable D high to A high register
+    a = (a & 0x00ff) | ((a | d) & 0xff00);
+  if (g.t4 & GA_EDALS) // enable D low to A low register
+    a = (a & 0xff00) | ((a | d) & 0x00ff);
+  if (g.t4 & GA_ETAHS) // enable D transposed to A high register
+    a = (a & 0x00ff) | ((a | (d << 8)) & 0xff00);
+  if (g.t4 & GA_ETALS) // enable D transposed to A low register
+    a = (a & 0xff00) | ((a | (d >> 8)) & 0x00ff);
+
+  if (g.t4 & GA_EDA1R) // enable D1 to A1 register
+    a = (a & 0x7fff) | ((a | d) & 0x8000);
+
+  if (g.t4 & GA_OVERFLOW_TO_C)
+    c = false;
+
+  if (g.t4 & GA_SET_C) // unconditionally set C
+    c = true;
+
+  if (g.t4 & GA_OVERFLOW_TO_C) // conditionally set C from adder output
+    c |= v;
+  if (g.t4 & GA_D1_TO_C)
+    c |= (d >> 15) & 1;
+}
+
+#ifdef TEST_GENERIC_GROUP_A
+/*
+ * The Group A microcode as it was modelled bit by bit, kept as
+ * the reference for test_generic_group_A()
+ */
+void CPU::generic_group_A_microcode(uint16_t instr) {
+  // first break the instruction into bits
+  bool M[17];
+  int i;
+
+  for (i=0; i<16; i++)
+    M[16-i] = (instr >> i) & 1;
+  M[0] = false; // (unused)
+
+  bool azzzz = false;
+
+  bool EASTL, EASBM, JAMKN, EIK17;
+  int16_t s1, s2, s=0;
+  bool v;
+  int d;
+  bool CLATR, CLA1R, EDAHS, EDALS, ETAHS, ETALS, EDA1R;
+  bool overflow_to_c, set_c, d1_to_c;
+
+  do {
+    // T2
+    if (azzzz) {
+      a = s & 0xffff;
+      half_cycles++;
+    }
+
+    // tlate
+
+    EASBM = (M[9] || M[11] || azzzz);
+    JAMKN = ((M[12] || M[16]) && (!azzzz));
+    EASTL = (JAMKN) || (EASBM);
+
+    //      EIK17 = ((M[15] || (c && (!M[13]))) && (!JAMKN));
+    EIK17 = (M[15] && (c || (!M[13])) && (!JAMKN));
+
+    s1 = (EASTL) ? a : 0;
+    s2 = (EASBM) ? 0 : 0xffff;
+
+    if (JAMKN) {
+      s = s1 ^ s2;
+      v=0;
+      (void) short_adc((s1 & 0x8000), (s2 & 0x8000), v);
+    } else {
+      v = EIK17;
+      s = short_adc(s1, s2, v);
+    }
+
+    // T3
+    d = 0xffff; // Due to CLDTR
     d &= s;     // Due to ESTDS
 
     azzzz = (M[8] && M[15] && (!azzzz));
@@ -1980,21 +2781,38 @@ void CPU::generic_group_A(uint16_t instr) {
     c |= (d >> 15) & 1;
 }
 
+#endif
+
 #ifdef TEST_GENERIC_GROUP_A
+/*
+ * Check that, for every Group A opcode and a spread of A and C,
+ * generic_group_A() gives the same A, C and timing as the bit-by-bit
+ * microcode, and that so do the dedicated routines for the opcodes
+ * that have them.
+ */
 void CPU::test_generic_group_A() {
   uint16_t i;
-  int j, k;
+  int j, k, n;
   uint16_t test_data[] = {
     0x0000, 0xffff, 0x5555, 0xaaaa,
     0x5aa5, 0xa55a, 0x137f, 0xfec8,
-    0x8000, 0};
+    0x8000, 0x7fff, 0x0001, 0x8001,
+    0xfffe, 0x00ff, 0xff00, 0x0080,
+    0x0100, 0x7ffe, 0};
   int16_t sav_a;
   bool sav_c;
   unsigned long sav_h;
   bool problem;
+  int problems = 0;
 
   for (i=0xc000; i<0xc400; i++) {
-    if (instr_table.dispatch(i) != &CPU::generic_group_A) {
+    for (n=0; n<2; n++) {
+      InstrTable::ExecFunc_pt f = ((n == 0) ?
+                       &CPU::generic_group_A_microcode :
+                       instr_table.dispatch(i));
+      if ((n == 1) && (f == &CPU::generic_group_A))
+        continue; // already tested against the microcode
+
       // test one instruction
       for (j=0; ((j==0)|test_data[j]); j++) {
         for (k=0; k<2; k++) {
@@ -2002,7 +2820,7 @@ void CPU::test_generic_group_A() {
           c = k;
           half_cycles = 0;
 
-          (this->*instr_table.dispatch(i))(i);
+          (this->*f)(i);
 
           sav_a = a;
           sav_c = c;
@@ -2024,15 +2842,22 @@ void CPU::test_generic_group_A() {
 
           if (problem) {
             fprintf(stderr,
-                    "'%06o a=%04x c=%d instr: a=%04x c=%d %ld   gen: a=%04x c=%d %ld\n",
+                    "'%06o a=%04x c=%d %s: a=%04x c=%d %ld   gen: a=%04x c=%d %ld\n",
                     i & 0xffff, test_data[j] & 0xffff, k,
+                    ((n == 0) ? "ucode" : "instr"),
                     sav_a & 0xffff, sav_c, sav_h,
                     a & 0xffff, c, half_cycles );
+            problems++;
           }
         }
       }
     }
   }
+
+  if (problems) {
+    fprintf(stderr, "%s: %d problems\n", __PRETTY_FUNCTION__, problems);
+    exit(1);
+  }
 }
 
 #endif
@@ -2046,15 +2871,151 @@ void CPU::write_prt(unsigned int n, uint16_t v) {
 }
 
 
+/*****************************************************************
+ * Pieces of the instruction cycle shared by both engines
+ *****************************************************************/
+
+/*
+ * Record the instruction (or break) just executed in the trace
+ */
+template<CPU::TraceMode TM>
+void CPU::trace_instr(uint16_t instr, uint16_t dmc_addr, int16_t dmc_data,
+                      bool dmc_erl)
+{
+  if constexpr (TM == TraceMode::FULL) {
+    btrace_buf[trace_ptr].brk = break_flag;
+    btrace_buf[trace_ptr].v = true;
+    btrace_buf[trace_ptr].half_cycles = half_cycles;
+    btrace_buf[trace_ptr].a = a;
+    btrace_buf[trace_ptr].b = b;
+    btrace_buf[trace_ptr].c = c;
+    btrace_buf[trace_ptr].x = x;
+    btrace_buf[trace_ptr].p = (break_flag) ? 0xffff : fetched_p;
+    btrace_buf[trace_ptr].y = y;  // EA of MR instructions
+    btrace_buf[trace_ptr].instr = instr;
+
+    if ((break_flag) && (instr < 16))  {
+      // DMC break
+      btrace_buf[trace_ptr].y = dmc_addr;
+      btrace_buf[trace_ptr].p = dmc_data;
+      btrace_buf[trace_ptr].c = dmc_erl;
+    }
+
+    trace_ptr = (trace_ptr + 1) & trace_mask;
+  } else if constexpr (TM == TraceMode::PC) {
+    pctrace_buf[trace_ptr].v = true;
+    pctrace_buf[trace_ptr].p = (break_flag) ? 0xffff : fetched_p;
+    pctrace_buf[trace_ptr].instr = instr;
+
+    trace_ptr = (trace_ptr + 1) & trace_mask;
+  } else if constexpr (TM == TraceMode::STREAM) {
+    TraceRecord r {half_cycles,
+                   uint16_t(a), uint16_t(b), uint16_t(x), c,
+                   uint16_t((break_flag) ? 0xffff : fetched_p),
+                   instr, y, break_flag};
+    if ((break_flag) && (instr < 16)) {
+      // DMC break
+      r.y = dmc_addr;
+      r.p = dmc_data;
+      r.c = dmc_erl;
+    }
+    trace_writer->record(r);
+  }
+}
+
+/*
+ * Figure out what break, if any, to do. If not a memory
+ * lockout violation then fetch the next instruction.
+ */
+void CPU::select_break()
+{
+  break_flag = false;
+
+  if (!break_pending()) {
+    (void) read(p);   // Nothing to do (the usual case)
+    return;
+  }
+
+  if (attention & ATTN_RTCLK) {
+    break_flag = true;
+    break_intr = false;
+    break_addr = 061;
+  } else if (attention & ATTN_DMC) {
+    break_flag = true;
+    break_intr = false;
+    // Lowest numbered channel first
+    dmc_dev = std::countr_zero(dmc_req);
+    break_addr = 000020 + (2 * dmc_dev);
+    dmc_req &= (dmc_req - 1);
+    if (dmc_req == 0)
+      attention &= ~ATTN_DMC;
+    dmc_cyc = true;
+    stats.dmc_cycles++;
+  } else if (pi && (attention & ATTN_INTERRUPT)) {
+    break_flag = true;
+    break_intr = true;
+    break_addr = 063;
+    stats.interrupts++;
+
+    pi = pi_pending = false; // disable interrupts
+    ea = ea_allowed; // force extended addressing
+    set_melov(false); // Drop MLO violation
+    melov_pending = false;
+  } if (melov()) {
+    break_flag = true;
+    break_intr = true;
+    break_addr = 062;
+    stats.interrupts++;
+
+    pi = pi_pending = false; // disable interrupts
+    pmi = ea; // Previous mode indicator
+    ea = ea_allowed; // force extended addressing
+    set_melov(false);
+    melov_pending = false;
+    ml = ml_pending = false;
+  } else {
+    (void) read(p);   // Leaving the instruction in the m register
+  }
+}
+
+/*
+ * Enable the interrupts (and memory lockout) an instruction
+ * after they were asked for
+ */
+void CPU::enable_pending()
+{
+  if (pi_pending && (!pi) && (!dmc_cyc)) {
+    pi = true;
+    pi_pending = false;
+  }
+  if (ml_pending && (!ml) && (!dmc_cyc)) {
+    ml = true;
+    ml_pending = false;
+  }
+}
+
 /*****************************************************************
  * This is where the action happens!
  *
  *****************************************************************/
 void CPU::do_instr(bool &run_flag) {
-  uint16_t instr;
+  stats.instructions++;
+  switch (trace_mode) {
+  case TraceMode::OFF:  do_instr_t<TraceMode::OFF>(run_flag);  break;
+  case TraceMode::PC:   do_instr_t<TraceMode::PC>(run_flag);   break;
+  case TraceMode::FULL: do_instr_t<TraceMode::FULL>(run_flag); break;
+  case TraceMode::STREAM: do_instr_t<TraceMode::STREAM>(run_flag); break;
+  }
+}
+
+template<CPU::TraceMode TM>
+void CPU::do_instr_t(bool &run_flag) {
+  uint16_t instr=0;
   uint16_t dmc_addr=0;
   int16_t dmc_data=0;
   bool dmc_erl=false;
+  const uint64_t start = half_cycles;
+  const bool brk = break_flag;
 
   run = true; // else we wouldn't have gotten here!
 
@@ -2089,7 +3050,7 @@ void CPU::do_instr(bool &run_flag) {
       fetched_p = 0;
 
       if ((!break_intr) && (break_addr == 061)) {
-        rtclk = false;
+        attention &= ~ATTN_RTCLK;
       }
     } else {
       instr = m;
@@ -2115,6 +3076,8 @@ void CPU::do_instr(bool &run_flag) {
       bool dmc_erl;
       uint16_t tmp_addr;
 
+      ++io_generation;
+
       // DMC cycle 1
       dmc_addr     = read(break_addr);
       tmp_addr     = dmc_addr;
@@ -2153,7 +3116,7 @@ void CPU::do_instr(bool &run_flag) {
 
       last_jmp_self_minus_one = jmp_self_minus_one;
       jmp_self_minus_one = false;
-      melov = melov_pending;
+      set_melov(melov_pending);
       melov_pending = false;
 
       /*
@@ -2164,26 +3127,7 @@ void CPU::do_instr(bool &run_flag) {
     }
 
     // binary trace ...
-
-    btrace_buf[trace_ptr].brk = break_flag;
-    btrace_buf[trace_ptr].v = true;
-    btrace_buf[trace_ptr].half_cycles = half_cycles;
-    btrace_buf[trace_ptr].a = a;
-    btrace_buf[trace_ptr].b = b;
-    btrace_buf[trace_ptr].c = c;
-    btrace_buf[trace_ptr].x = x;
-    btrace_buf[trace_ptr].p = (break_flag) ? 0xffff : fetched_p;
-    btrace_buf[trace_ptr].y = y;  // EA of MR instructions
-    btrace_buf[trace_ptr].instr = instr;
-
-    if ((break_flag) && (instr < 16))  {
-      // DMC break
-      btrace_buf[trace_ptr].y = dmc_addr;
-      btrace_buf[trace_ptr].p = dmc_data;
-      btrace_buf[trace_ptr].c = dmc_erl;
-    }
-
-    trace_ptr = (trace_ptr + 1) % TRACE_BUF;
+    trace_instr<TM>(instr, dmc_addr, dmc_data, dmc_erl);
   } else {
     p = y; /* Front panel updates Y not P
             * So copy Y into P before fetching */
@@ -2191,66 +3135,588 @@ void CPU::do_instr(bool &run_flag) {
 
   op = (c << 8) | (pi << 7) | (ml << 5) | (ea << 4) | (dp << 3);
 
-  break_flag = false;
+  select_break();
+
+  half_cycles += 2; // Due to fetch
+
+  if (fetched) {
+    enable_pending();
+
+    if (profiling)
+      profile_instr(brk, instr, start);
+    if (watching)
+      watch_exec();
+  }
+  
+  fetched = true;
+  run_flag = run; // pass back the run status
+}
+
+/*
+ * Execute up to count instructions, stopping early if the
+ * processor halts or half_cycles reaches deadline (which may
+ * be lowered while running, by a device or signal handler).
+ * Returns the number of instructions not executed.
+ *
+ * Idle loops are only skipped with tracing off, since the trips
+ * skipped would be missing from the trace.
+ */
+template<CPU::TraceMode TM>
+uint64_t CPU::do_instrs_t(uint64_t count, const volatile uint64_t &deadline,
+                          bool &run_flag)
+{
+  do {
+    if constexpr (TM == TraceMode::OFF) {
+      if (idle_jump)
+        count = skip_idle(count, deadline);
+    }
+
+    do_instr_t<TM>(run_flag);
+  } while ((--count) && run_flag && (half_cycles < deadline));
+
+  return count;
+}
+
+/*
+ * The BLOCK engine. Equivalent to do_instrs_t(), but while the
+ * processor is just stepping through instructions (no break being
+ * taken, nothing changed from the front panel) whole runs of them
+ * are done by run_blocks(), straight from the decode cache.
+ * Anything out of the ordinary goes through do_instr_t() as usual.
+ */
+template<CPU::TraceMode TM>
+uint64_t CPU::do_blocks_t(uint64_t count, const volatile uint64_t &deadline,
+                          bool &run_flag)
+{
+  const bool checks = profiling || watching;
+
+  do {
+    if constexpr (TM == TraceMode::OFF) {
+      if (idle_jump)
+        count = skip_idle(count, deadline);
+    }
+
+    const uint16_t addr = p & addr_mask;
+    const Decoded *d = &decoded[addr];
+
+    if ((!fetched) || (break_flag)) {
+      do_instr_t<TM>(run_flag);
+      --count;
+      continue;
+    }
+
+    if (!(d->flags & D_VALID))
+      decode_block(addr);
+
+    if (d->instr != uint16_t(m)) {
+      do_instr_t<TM>(run_flag); // M was changed behind our back
+      --count;
+      continue;
+    }
+
+    count = (checks) ?
+      run_blocks<TM, true>(d, count, deadline) :
+      run_blocks<TM, false>(d, count, deadline);
+    run_flag = run;
+  } while (count && run_flag && (half_cycles < deadline));
+
+  return count;
+}
+
+/*
+ * Run instructions from the decode cache, starting with d (the
+ * instruction already in M), exactly as do_instr_t() would, for as
+ * long as each one just leads on to the next: until a break is to
+ * be taken, the processor halts, the count or the deadline runs
+ * out, or (with idle loop skipping) a backward jump is taken.
+ * Following a jump costs no more than stepping on to the next
+ * word, so a loop runs here until one of those happens. CHECKS
+ * is for profiling and watchpoints. Returns the count left.
+ */
+template<CPU::TraceMode TM, bool CHECKS>
+uint64_t CPU::run_blocks(const Decoded *d, uint64_t count,
+                         const volatile uint64_t &deadline)
+{
+  run = true;
+
+  for (;;) {
+    const uint16_t instr = d->instr;
+    fetched_p = p;
+    m = 0;
+    increment_p();
+    m = instr;
+
+    last_jmp_self_minus_one = jmp_self_minus_one;
+    jmp_self_minus_one = false;
+    set_melov(melov_pending);
+    melov_pending = false;
+
+    const uint64_t start = half_cycles;
+    decoded_ea = d->flags & D_EA;
+    decoded_y = d->y;
+    (this->*d->exec)(instr);
+    decoded_ea = 0;
+
+    trace_instr<TM>(instr, 0, 0, false);
+
+    op = (c << 8) | (pi << 7) | (ml << 5) | (ea << 4) | (dp << 3);
+
+    if (break_pending())
+      select_break();
+    else
+      (void) read(p); // Fetch the next instruction
+
+    half_cycles += 2; // Due to fetch
+
+    if (pi_pending || ml_pending)
+      enable_pending();
+
+    if constexpr (CHECKS) {
+      if (profiling)
+        profile_instr(false, instr, start);
+      if (watching)
+        watch_exec();
+    }
+
+    if ((!--count) || (!run) || break_flag || (half_cycles >= deadline))
+      return count;
+    if constexpr (TM == TraceMode::OFF) {
+      if (idle_jump)
+        return count;
+    }
+
+    /*
+     * M now holds the next instruction, read from core, so the
+     * decode cache (which is invalidated by any write) agrees
+     */
+    const uint16_t addr = p & addr_mask;
+    d = &decoded[addr];
+    if (!(d->flags & D_VALID))
+      decode_block(addr);
+  }
+}
+
+uint64_t CPU::do_instrs(uint64_t count, const volatile uint64_t &deadline,
+                        bool &run_flag)
+{
+  if (count == 0)
+    return 0;
+
+  idle.valid = false; // Anything may have happened since last time
+  waiting_for_input = false;
 
   /*
-   * Figure out what break, if any, to do.
+   * Only the program's own accesses are watched, not the
+   * monitor's or a loader's
    */
-  if (rtclk) {
-    break_flag = true;
-    break_intr = false;
-    break_addr = 061;
-  } else if (dmc_req != 0) {
-    break_flag = true;
-    break_intr = false;
-    for (int i=0; i<16; i++) {
-      const unsigned int mask = (1 << i);
-      if ((dmc_req & mask) != 0) {
-        break_addr = 000020 + (2 * i);
-        dmc_req &= (~mask);
-        dmc_dev = i;
-        break;
+  const uint64_t start_count = count;
+  watching = watch_armed;
+  count = do_engine(count, deadline, run_flag);
+  watching = false;
+  stats.instructions += start_count - count;
+
+  return count;
+}
+
+uint64_t CPU::do_engine(uint64_t count, const volatile uint64_t &deadline,
+                        bool &run_flag)
+{
+  if (engine == Engine::BLOCK) {
+    switch (trace_mode) {
+    case TraceMode::OFF:
+      return do_blocks_t<TraceMode::OFF>(count, deadline, run_flag);
+    case TraceMode::PC:
+      return do_blocks_t<TraceMode::PC>(count, deadline, run_flag);
+    case TraceMode::STREAM:
+      return do_blocks_t<TraceMode::STREAM>(count, deadline, run_flag);
+    case TraceMode::FULL:
+    default:
+      return do_blocks_t<TraceMode::FULL>(count, deadline, run_flag);
+    }
+  }
+
+  switch (trace_mode) {
+  case TraceMode::OFF:
+    return do_instrs_t<TraceMode::OFF>(count, deadline, run_flag);
+  case TraceMode::PC:
+    return do_instrs_t<TraceMode::PC>(count, deadline, run_flag);
+  case TraceMode::STREAM:
+    return do_instrs_t<TraceMode::STREAM>(count, deadline, run_flag);
+  case TraceMode::FULL:
+  default:
+    return do_instrs_t<TraceMode::FULL>(count, deadline, run_flag);
+  }
+}
+
+/*
+ * Translate the straight-line run of instructions starting at
+ * addr into the decode cache. The run ends after an unconditional
+ * jump or a halt, at an instruction that is already decoded, or
+ * at the end of memory. Each entry stays valid until that word of
+ * core is written.
+ */
+void CPU::decode_block(uint16_t addr)
+{
+  for (unsigned n = 0; n < MAX_BLOCK_LENGTH; n++) {
+    Decoded &d = decoded[addr];
+    const uint16_t instr = core[addr];
+
+    d.exec = instr_table.dispatch(instr);
+    d.instr = instr;
+    d.y = 0;
+    d.flags = D_VALID;
+
+    if (instr_table.type(instr) == InstrTable::Instr::MR) {
+      if (instr & 0x8000)
+        d.flags |= D_INDIRECT;
+      else {
+        d.flags |= D_DIRECT;
+        d.y = instr & 0x01ff;
+        if (!(instr & 0x0200))
+          d.flags |= D_SECTOR_ZERO;
+        // (LDX and STX use that bit as part of the opcode)
+        if ((instr & 0x4000) &&
+            (d.exec != &CPU::do_LDX) && (d.exec != &CPU::do_STX))
+          d.flags |= D_INDEXED;
       }
     }
-    dmc_cyc = true;
-  } else if (pi && (interrupts || start_button_interrupt)) {
-    break_flag = true;
-    break_intr = true;
-    break_addr = 063;
 
-    pi = pi_pending = false; // disable interrupts
-    ea = ea_allowed; // force extended addressing
-    melov = melov_pending = false; // Drop MLO violation
-  } if (melov) {
-    break_flag = true;
-    break_intr = true;
-    break_addr = 062;
+    if ((d.exec == &CPU::do_JMP) || (d.exec == &CPU::do_HLT) ||
+        (addr == addr_mask) || (decoded[addr + 1].flags & D_VALID))
+      break;
 
-    pi = pi_pending = false; // disable interrupts
-    pmi = ea; // Previous mode indicator
-    ea = ea_allowed; // force extended addressing
-    melov = melov_pending = false;
-    ml = ml_pending = false;
+    addr++;
+  }
+}
+
+/*****************************************************************
+ * Snapshots
+ *****************************************************************/
+void CPU::save_state(SnapshotWriter &w)
+{
+  w.begin("CPU ");
+  save_registers(w);
+  w.end();
+
+  w.begin("CORE");
+  for (auto v: core)
+    w.put16(v);
+  for (bool v: modified)
+    w.put_bool(v);
+  w.end();
+}
+
+void CPU::save_registers(SnapshotWriter &w)
+{
+  w.put_bool(ea_allowed);
+  w.put16(addr_mask);
+
+  w.put16(a);
+  w.put16(b);
+  w.put16(x);
+  w.put16(p);
+  w.put16(sc);
+  w.put16(j);
+  for (bool v: prt)
+    w.put_bool(v);
+
+  w.put_bool(c);
+  w.put_bool(pi);
+  w.put_bool(ml);
+  w.put_bool(ea);
+  w.put_bool(dp);
+
+  w.put16(op);
+  w.put16(m);
+  w.put16(y);
+
+  w.put_bool(start_button_interrupt);
+  w.put16(interrupts);
+  w.put16(dmc_req);
+  w.put8(attention);
+
+  w.put_bool(run);
+  w.put_bool(fetched);
+  w.put_bool(pi_pending);
+  w.put_bool(ml_pending);
+  w.put_bool(ea_disable);
+  w.put_bool(pmi);
+  w.put_bool(melov_pending);
+  w.put_bool(dmc_cyc);
+  w.put8(dmc_dev);
+  w.put16(fetched_p);
+  w.put_bool(break_flag);
+  w.put_bool(break_intr);
+  w.put16(break_addr);
+  w.put_bool(jmp_self_minus_one);
+  w.put_bool(last_jmp_self_minus_one);
+
+  w.put64(half_cycles);
+
+  for (int i=0; i<4; i++)
+    w.put_bool(ss[i]);
+}
+
+/*
+ * The sections must be at least as long as this build writes
+ * them (they may grow at the end), and memory exactly the same
+ * size
+ */
+bool CPU::check_state(SnapshotReader &r)
+{
+  SnapshotWriter w;
+  const size_t before = w.size();
+  save_registers(w);
+  const size_t registers_length = w.size() - before;
+
+  if (!r.begin("CPU "))
+    return false;
+
+  const size_t length = r.left();
+  const bool saved_ea_allowed = r.get_bool();
+  const uint16_t saved_addr_mask = r.get16();
+  r.end();
+
+  if ((saved_ea_allowed != ea_allowed) || (saved_addr_mask != addr_mask)) {
+    std::cerr << "Snapshot is of a different machine configuration" << std::endl;
+    return false;
+  }
+
+  if ((length < registers_length) || (!r.begin("CORE")))
+    return false;
+
+  const bool ok = (r.left() == ((2 * core.size()) + modified.size()));
+  r.end();
+
+  if (!ok) {
+    std::cerr << "Snapshot memory is a different size" << std::endl;
+    return false;
+  }
+
+  return r.ok();
+}
+
+bool CPU::restore_state(SnapshotReader &r)
+{
+  if (!r.begin("CPU "))
+    return false;
+
+  const bool saved_ea_allowed = r.get_bool();
+  const uint16_t saved_addr_mask = r.get16();
+  if ((saved_ea_allowed != ea_allowed) || (saved_addr_mask != addr_mask)) {
+    std::cerr << "Snapshot is of a different machine configuration" << std::endl;
+    return false;
+  }
+
+  a = r.get16();
+  b = r.get16();
+  x = r.get16();
+  p = r.get16();
+  sc = r.get16();
+  j = r.get16();
+  for (auto &v: prt)
+    v = r.get_bool();
+
+  c = r.get_bool();
+  pi = r.get_bool();
+  ml = r.get_bool();
+  ea = r.get_bool();
+  dp = r.get_bool();
+
+  op = r.get16();
+  m = r.get16();
+  y = r.get16();
+
+  start_button_interrupt = r.get_bool();
+  interrupts = r.get16();
+  dmc_req = r.get16();
+  attention = r.get8();
+
+  run = r.get_bool();
+  fetched = r.get_bool();
+  pi_pending = r.get_bool();
+  ml_pending = r.get_bool();
+  ea_disable = r.get_bool();
+  pmi = r.get_bool();
+  melov_pending = r.get_bool();
+  dmc_cyc = r.get_bool();
+  dmc_dev = r.get8();
+  fetched_p = r.get16();
+  break_flag = r.get_bool();
+  break_intr = r.get_bool();
+  break_addr = r.get16();
+  jmp_self_minus_one = r.get_bool();
+  last_jmp_self_minus_one = r.get_bool();
+
+  half_cycles = r.get64();
+
+  for (int i=0; i<4; i++)
+    ss[i] = r.get_bool();
+
+  r.end();
+
+  if (!r.begin("CORE"))
+    return false;
+  for (auto &v: core)
+    v = r.get16();
+  for (unsigned i=0; i<modified.size(); i++)
+    modified[i] = r.get_bool();
+  r.end();
+
+  // Everything that depends on what was in memory
+  ++write_generation;
+  for (auto &g: sector_generation)
+    g = write_generation;
+  invalidate_decoded();
+  decoded_ea = 0;
+  idle_jump = false;
+  idle.valid = false;
+
+  return r.ok();
+}
+
+void CPU::invalidate_decoded()
+{
+  for (auto &d: decoded) {
+    d.flags = 0;
+  }
+}
+
+void CPU::set_engine(Engine e)
+{
+  engine = e;
+  invalidate_decoded();
+}
+
+bool CPU::parse_engine(const std::string &s, Engine &e)
+{
+  bool ok = true;
+
+  if (s == "interp")
+    e = Engine::INTERP;
+  else if (s == "block")
+    e = Engine::BLOCK;
+  else
+    ok = false;
+
+  return ok;
+}
+
+const char *CPU::engine_name(Engine e)
+{
+  switch (e) {
+  case Engine::BLOCK: return "block";
+  default:            return "interp";
+  }
+}
+
+/*
+ * Select the trace capture level and the number of entries
+ * in the trace ring (rounded up to a power of two). Only the
+ * ring for the selected level is allocated, and any previous
+ * trace is discarded.
+ */
+void CPU::set_trace(TraceMode mode, unsigned entries)
+{
+  if (mode == TraceMode::STREAM) {
+    // Only set_trace_file() can start streaming
+    mode = trace_mode;
   } else {
-    (void) read(p);   // Leaving the instruction in the m register
+    (void) close_trace_file();
   }
 
-  half_cycles += 2; // Due to fetch
+  unsigned size = 1;
+  while ((size < entries) && (size < MAX_TRACE_ENTRIES))
+    size <<= 1;
 
-  if (fetched) {
-    /*
-     * Enable the interrupts
-     */
-    if (pi_pending && (!pi) && (!dmc_cyc)) {
-      pi = true;
-      pi_pending = false;
-    }
-    if (ml_pending && (!ml) && (!dmc_cyc)) {
-      ml = true;
-      ml_pending = false;
+  trace_mode = mode;
+  trace_ptr = 0;
+  trace_mask = size - 1;
+
+  btrace_buf.clear();
+  btrace_buf.shrink_to_fit();
+  pctrace_buf.clear();
+  pctrace_buf.shrink_to_fit();
+
+  switch (mode) {
+  case TraceMode::FULL:
+    btrace_buf.resize(size);
+    for (auto &t: btrace_buf) {
+      t.v = false;
     }
+    break;
+  case TraceMode::PC:
+    pctrace_buf.assign(size, PCtrace{false, 0xffff, 0xffff});
+    break;
+  case TraceMode::OFF:
+  case TraceMode::STREAM:
+    break;
+  }
+}
+
+/*
+ * Start streaming a full trace to a file, replacing whatever
+ * trace mode was in effect.
+ */
+bool CPU::set_trace_file(const std::string &filename)
+{
+  if (!trace_writer)
+    trace_writer = new TraceWriter;
+
+  bool ok = trace_writer->open(filename);
+  if (ok) {
+    trace_mode = TraceMode::STREAM;
+    trace_ptr = 0;
+    btrace_buf.clear();
+    btrace_buf.shrink_to_fit();
+    pctrace_buf.clear();
+    pctrace_buf.shrink_to_fit();
+  }
+
+  return ok;
+}
+
+/*
+ * Stop streaming (if it is happening) and leave tracing off
+ */
+bool CPU::close_trace_file()
+{
+  bool ok = true;
+
+  if (trace_writer) {
+    ok = trace_writer->close();
+    delete trace_writer;
+    trace_writer = nullptr;
+  }
+
+  if (trace_mode == TraceMode::STREAM)
+    trace_mode = TraceMode::OFF;
+
+  return ok;
+}
+
+bool CPU::parse_trace_mode(const std::string &s, TraceMode &mode)
+{
+  bool ok = true;
+
+  if (s == "off")
+    mode = TraceMode::OFF;
+  else if (s == "pc")
+    mode = TraceMode::PC;
+  else if (s == "full")
+    mode = TraceMode::FULL;
+  else
+    ok = false;
+
+  return ok;
+}
+
+const char *CPU::trace_mode_name(TraceMode mode)
+{
+  switch (mode) {
+  case TraceMode::OFF: return "off";
+  case TraceMode::PC:  return "pc";
+  case TraceMode::STREAM: return "stream";
+  default:             return "full";
   }
-  
-  fetched = true;
-  run_flag = run; // pass back the run status
 }
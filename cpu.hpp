@@ -24,6 +24,8 @@
 #include <vector>
 #include <array>
 #include <cstdint>
+#include <string>
+#include <unordered_map>
 
 #include "instr.hpp"
 #include "io_types.hpp"
@@ -31,6 +33,10 @@
 struct FP_INTF;
 
 namespace h16 {
+  class TraceWriter;
+  class SnapshotWriter;
+  class SnapshotReader;
+
   class CPU {
     friend class InstrTable;
     
@@ -72,9 +78,222 @@ namespace h16 {
 
     int get_wrt_info(uint16_t addr[2], uint16_t data[2]);
 
+    /*
+     * Memory write generations. Every write to core (including
+     * DMC input and front-panel stores) bumps the write generation
+     * and stamps the sector it lands in with the new value, so
+     * anything holding a view of memory can cheaply tell whether
+     * the part it looked at has changed since.
+     */
+    static const unsigned SECTOR_SHIFT = 9; // 512 words
+    uint64_t get_write_generation() {return write_generation;}
+    unsigned get_sectors() {return sector_generation.size();}
+    uint64_t get_sector_generation(unsigned sector)
+    {return sector_generation[sector];}
+    bool changed_since(uint64_t generation, uint16_t first, uint16_t last);
+
+    /*
+     * Store straight into core for loaders run on the host, without
+     * the side effects of a store by the program (X, M, Y, memory
+     * lockout) but counting as a write like any other.
+     */
+    void deposit(uint16_t addr, uint16_t data);
+
+    /*
+     * Leave the processor as it is just after a HLT at addr has
+     * been executed, in extended addressing mode (if the machine
+     * has it) or not
+     */
+    void set_halted(uint16_t addr, bool extend);
+
+    /*
+     * Snapshots of the whole processor, registers, keys, break
+     * logic and memory. Restoring counts as writing all of memory.
+     * check_state() reads the same sections but changes nothing,
+     * and fails if restore_state() would.
+     */
+    void save_state(SnapshotWriter &w);
+    bool check_state(SnapshotReader &r);
+    bool restore_state(SnapshotReader &r);
+
     std::string dis();
 
     struct FP_INTF *fp_intf();
+
+    /*
+     * Instruction trace capture level. OFF costs nothing in the
+     * run loop, PC records just the address and instruction, FULL
+     * records the registers as well. STREAM writes full records
+     * to a file (see set_trace_file()) rather than the ring.
+     */
+    enum class TraceMode {
+      OFF, PC, FULL, STREAM
+    };
+    static const unsigned DEFAULT_TRACE_ENTRIES = 1024*1024;
+    static const unsigned MAX_TRACE_ENTRIES = 1u << 30;
+
+    void set_trace(TraceMode mode, unsigned entries);
+    static bool parse_trace_mode(const std::string &s, TraceMode &mode);
+    static const char *trace_mode_name(TraceMode mode);
+    bool set_trace_file(const std::string &filename);
+    bool close_trace_file();
+    TraceMode get_trace_mode() {return trace_mode;}
+    unsigned get_trace_entries() {return trace_mask + 1;}
+
+    /*
+     * Execution engine. INTERP decodes each instruction as it is
+     * fetched. BLOCK runs from a cache of pre-decoded instructions,
+     * translated a basic block at a time and invalidated by writes
+     * to memory. Both give identical results and timing.
+     */
+    enum class Engine {
+      INTERP, BLOCK
+    };
+
+    void set_engine(Engine e);
+    Engine get_engine() {return engine;}
+    static bool parse_engine(const std::string &s, Engine &e);
+    static const char *engine_name(Engine e);
+
+    /*
+     * Idle loop skipping. A backward JMP of no more than
+     * the idle length (0 turns this off) marks a possible idle
+     * loop. If one trip round it leaves the processor exactly as
+     * it was, with nothing written to memory and no I/O done,
+     * then so will every trip until the next event, so whole
+     * trips are skipped, exactly as if they had been executed.
+     */
+    static const unsigned DEFAULT_IDLE_LENGTH = 8;
+    void set_idle_length(unsigned n) { idle_length = n; idle.valid = false; }
+    unsigned get_idle_length() { return idle_length; }
+    uint64_t get_idle_skipped() { return idle_skipped; }
+
+    /*
+     * Running totals, for the monitor's stats command. Each is
+     * counted where it costs least: instructions as do_instrs()
+     * returns (idle trips skipped included, as if executed), the
+     * rest only on the paths that they count.
+     */
+    struct Stats {
+      uint64_t instructions;
+      uint64_t interrupts;      // breaks through '62 or '63
+      uint64_t dmc_cycles;
+      uint64_t idle_skips;      // idle loops skipped by skip_idle()
+      uint64_t idle_skipped;    // half-cycles
+      uint64_t io_poll_jumps;   // time jumps by optimize_io_poll()
+      uint64_t io_poll_skipped; // half-cycles
+    };
+    const Stats &get_stats() { return stats; }
+    void clear_stats() { stats = Stats(); }
+
+    /*
+     * Set when the last do_instrs() ended in an idle loop that
+     * nothing but outside input (from the terminal or front panel)
+     * can ever get out of, since idle_deadline() said no event
+     * would come.
+     */
+    bool get_waiting_for_input() { return waiting_for_input; }
+
+    /*
+     * Execution profile. While on, each instruction adds one to
+     * the count for its address and for its instruction word, and
+     * the half-cycles it took (fetching the next included) to
+     * both. Interrupt and DMC breaks are counted together, and
+     * trips round an idle loop that are skipped are not counted
+     * at all. Off costs one test per instruction.
+     */
+    struct ProfileCount {
+      uint64_t count;
+      uint64_t half_cycles;
+    };
+
+    void set_profile(bool on);
+    bool get_profile() { return profiling; }
+    void clear_profile();
+
+    /*
+     * Call graph. While on, a JST (or an interrupt) pushes its
+     * entry point onto a shadow call stack, and an indirect JMP
+     * that lands where the entry word of a subroutine on the stack
+     * points (JMP* entry, after any IRS for a skip return) pops
+     * back to its caller. Half-cycles are charged to the node of
+     * the call tree for the stack at the time, so a node's
+     * inclusive time is the sum over its subtree. Subroutines are
+     * not reentrant, so a JST to one already on the stack unwinds
+     * to that one's caller first. Off costs one test per JST and
+     * JMP.
+     */
+    struct CallNode {
+      uint16_t entry;       // CALL_ROOT for the main program
+      uint32_t parent;
+      uint64_t calls;
+      uint64_t half_cycles; // exclusive
+    };
+    static const uint16_t CALL_ROOT = 0xffff;
+    static const unsigned CALL_DEPTH = 256;
+
+    void set_callgraph(bool on);
+    bool get_callgraph() { return call_tracing; }
+    void clear_callgraph();
+
+    /*
+     * Breakpoints and watchpoints. Each word of memory has a set
+     * of WATCH_ bits, and each I/O device address (as in
+     * IoDispatch::Device) a bit of io_watch. A hit is passed to
+     * watch_hit() and the instruction (or DMC cycle) finishes as
+     * usual, so for WATCH_EXEC the processor stops just before
+     * the instruction at the breakpoint. None of this is looked
+     * at unless something is being watched.
+     */
+    static const uint8_t WATCH_EXEC  = 0x01; // Instruction about to be executed
+    static const uint8_t WATCH_READ  = 0x02; // Data read (including DMC output)
+    static const uint8_t WATCH_WRITE = 0x04; // Data write (including DMC input)
+    static const uint8_t WATCH_IO    = 0x08; // I/O instruction, by device address
+
+    struct WatchHit {
+      uint8_t kind;  // One of the WATCH_ bits
+      uint16_t addr; // Memory or device address
+      uint16_t data; // Word read or written, or the I/O instruction
+      uint16_t p;    // Address of the instruction
+      bool dmc;      // In a DMC cycle rather than an instruction
+    };
+
+    void set_watch(uint16_t addr, uint8_t kinds, bool on);
+    uint8_t get_watch(uint16_t addr) { return watch[addr & addr_mask]; }
+    void set_io_watch(unsigned device, bool on);
+    bool get_io_watch(unsigned device) { return ((io_watch >> (device & 077)) & 1) != 0; }
+    void clear_watches(uint8_t kinds);
+
+    /*
+     * A condition on a breakpoint or watchpoint, such as
+     * "a == '177777 and x > 10" or "hits == 5000", parsed once
+     * into a list of terms, each comparing one field with a
+     * constant ("and" binds tighter than "or"). Registers compare
+     * as unsigned 16-bit numbers, keys is the word INK would read
+     * and hits counts the times the point has been reached, this
+     * one included. A point with a condition only stops the
+     * processor when the condition is met.
+     */
+    struct Condition {
+      enum class Field : uint8_t {
+        A, B, X, P, C, KEYS, HALF_CYCLES, HITS
+      };
+      enum class Op : uint8_t {
+        EQ, NE, LT, LE, GT, GE
+      };
+      struct Term {
+        Field field;
+        Op op;
+        bool or_before; // first term of another "or" clause
+        uint64_t value;
+      };
+      std::vector<Term> terms;
+      std::string text;
+    };
+
+    static bool parse_condition(const std::string &s, Condition &cond);
+    void set_condition(uint16_t addr, uint8_t kind, const Condition &cond);
+    const Condition *get_condition(uint16_t addr, uint8_t kind, uint64_t &hits);
   
     /*
      * Interface routines to read and write memory
@@ -86,9 +305,19 @@ namespace h16 {
     uint16_t read(uint16_t addr) {
       y = addr;
       m = core[addr & addr_mask];
+      if (watching && (watch[addr & addr_mask] & WATCH_READ))
+        watch_access(WATCH_READ, addr, m);
       return m;
     };
 
+    /*
+     * Look at and store to memory from the monitor, without
+     * disturbing the M and Y registers (M may hold the next
+     * instruction, already fetched)
+     */
+    uint16_t peek(uint16_t addr) { return core[addr & addr_mask]; }
+    void poke(uint16_t addr, uint16_t data);
+
   private:
     const bool ea_allowed; // i.e. whether CPU has extended addressing
     const uint16_t addr_mask;
@@ -110,13 +339,39 @@ namespace h16 {
                      int16_t &data, bool erl) = 0;
     virtual bool jump_time_to_event(uint64_t &half_cycles) = 0;
     virtual void io_polling(uint16_t instr) = 0;
+
+    /*
+     * How far an idle loop could run, at most, before anything
+     * outside the CPU happens (UINT64_MAX if nothing ever will).
+     * By default just the deadline.
+     */
+    virtual uint64_t idle_deadline(uint64_t deadline) { return deadline; }
+
+    /*
+     * A breakpoint or watchpoint was hit, in do_instrs()
+     */
+    virtual void watch_hit(const WatchHit &hit) {}
   
     void do_instr(bool &run_flag);
+    template<TraceMode TM> void do_instr_t(bool &run_flag);
+    template<TraceMode TM> uint64_t do_instrs_t(uint64_t count,
+                                                 const volatile uint64_t &deadline,
+                                                 bool &run_flag);
+    template<TraceMode TM> uint64_t do_blocks_t(uint64_t count,
+                                                 const volatile uint64_t &deadline,
+                                                 bool &run_flag);
+    uint64_t do_instrs(uint64_t count, const volatile uint64_t &deadline,
+                       bool &run_flag);
+    uint64_t do_engine(uint64_t count, const volatile uint64_t &deadline,
+                       bool &run_flag);
 
     void set_run(bool x) { run = x; }
     bool get_run() { return run; }
 
-    void set_sbi(bool x) { start_button_interrupt = x; }
+    void set_sbi(bool x) {
+      start_button_interrupt = x;
+      update_interrupt_attention();
+    }
     
     /*
      * The core memory 
@@ -136,8 +391,37 @@ namespace h16 {
       uint16_t p, instr, y;
     };
 
+    struct PCtrace {
+      bool v; // valid flag
+      uint16_t p; // 0xffff for a break
+      uint16_t instr;
+    };
+
+    TraceMode trace_mode;
     unsigned trace_ptr;
+    unsigned trace_mask; // Ring size is a power of two
     std::vector<Btrace> btrace_buf;
+    std::vector<PCtrace> pctrace_buf;
+    TraceWriter *trace_writer;
+
+    /*
+     * Profiling
+     */
+    bool profiling;
+    std::vector<ProfileCount> profile;     // by address
+    std::vector<ProfileCount> profile_ops; // by instruction word
+    ProfileCount profile_breaks;
+    uint64_t profile_idle_skipped;         // idle_skipped when cleared
+
+    bool call_tracing;
+    std::vector<CallNode> call_nodes;      // call_nodes[0] is the root
+    std::vector<uint32_t> call_stack;      // indices into call_nodes
+    std::unordered_map<uint64_t, uint32_t> call_children; // parent<<16|entry
+    uint64_t call_last;                    // half_cycles last charged
+    void call_charge() {
+      call_nodes[call_stack.back()].half_cycles += half_cycles - call_last;
+      call_last = half_cycles;
+    }
 
   private:
 
@@ -165,9 +449,32 @@ namespace h16 {
     // Interrupt and break requests
     bool start_button_interrupt;
     uint16_t interrupts;
-    bool rtclk;
     uint16_t dmc_req;
-    bool melov; // Memory Lockout Violation
+
+    /*
+     * One bit for each source of break, so that the usual case of
+     * nothing to do is a single test at the end of an instruction.
+     * ATTN_INTERRUPT is set whenever an interrupt is requested,
+     * and only counts if interrupts are enabled (pi).
+     */
+    static const uint8_t ATTN_RTCLK     = 0x01; // Real-time clock
+    static const uint8_t ATTN_DMC       = 0x02; // dmc_req != 0
+    static const uint8_t ATTN_INTERRUPT = 0x04; // interrupts || SBI
+    static const uint8_t ATTN_MELOV     = 0x08; // Memory Lockout Violation
+    uint8_t attention;
+
+    bool break_pending() const {
+      return (attention & (pi ? 0xff : ~ATTN_INTERRUPT)) != 0;
+    }
+    bool melov() const { return (attention & ATTN_MELOV) != 0; }
+    void set_melov(bool v) {
+      attention = (attention & ~ATTN_MELOV) | (v ? ATTN_MELOV : 0);
+    }
+    void update_interrupt_attention() {
+      attention = ((attention & ~ATTN_INTERRUPT) |
+                   ((interrupts || start_button_interrupt) ?
+                    ATTN_INTERRUPT : 0));
+    }
 
     // Various flags
     bool run;     // flag to say still running
@@ -191,8 +498,80 @@ namespace h16 {
     bool jmp_self_minus_one;
     bool last_jmp_self_minus_one;
 
+    // Idle loop skipping
+    struct IdleState {
+      bool valid;
+      uint16_t p, keys;
+      int16_t a, b, x, sc;
+      uint16_t j;
+      uint64_t half_cycles;
+      uint64_t write_generation;
+      uint64_t io_generation;
+      uint64_t count;
+    };
+    unsigned idle_length;
+    bool idle_jump;             // backward JMP just done
+    uint64_t io_generation;     // bumped by I/O with side effects
+    uint64_t idle_skipped;      // half-cycles skipped
+    bool waiting_for_input;
+    Stats stats;
+    IdleState idle;
+
+    // Breakpoints and watchpoints
+    std::vector<uint8_t> watch; // WATCH_ bits for each word of core
+    uint64_t io_watch;          // One bit for each device address
+    bool watch_armed;           // Anything at all in watch or io_watch
+    bool watching;              // watch_armed, while in do_instrs()
+
+    struct CondWatch {
+      Condition cond;
+      uint64_t hits;
+    };
+    std::unordered_map<uint32_t, CondWatch> conditions; // by watch_key()
+
+    static uint32_t watch_key(uint8_t kind, uint16_t addr) {
+      return (uint32_t(kind) << 16) | addr;
+    }
+    void clear_conditions(uint16_t addr, uint8_t kinds);
+    bool condition_met(CondWatch &w);
+
+    void update_watch_armed();
+    void watch_access(uint8_t kind, uint16_t addr, uint16_t data);
+    void watch_io(uint16_t instr) {
+      if (watching && ((io_watch >> (instr & 077)) & 1))
+        watch_access(WATCH_IO, instr & 077, instr);
+    }
+    void call_push(uint16_t entry);
+    void call_return();
+    void profile_instr(bool brk, uint16_t instr, uint64_t start) {
+      const uint64_t hc = half_cycles - start;
+      if (brk) {
+        profile_breaks.count++;
+        profile_breaks.half_cycles += hc;
+      } else {
+        ProfileCount &a = profile[fetched_p & addr_mask];
+        ProfileCount &o = profile_ops[instr];
+        a.count++;
+        a.half_cycles += hc;
+        o.count++;
+        o.half_cycles += hc;
+      }
+    }
+    void watch_exec() {
+      if ((!break_flag) && (watch[p & addr_mask] & WATCH_EXEC))
+        watch_access(WATCH_EXEC, p, m);
+    }
+
+    // Effective address as far as decoded by the BLOCK engine
+    uint8_t decoded_ea;
+    uint16_t decoded_y;
+
     uint64_t half_cycles;
 
+    // Memory write generations
+    uint64_t write_generation;
+    std::vector<uint64_t> sector_generation;
+
     // Memory write testing
     int wrts;
     uint16_t wrt_addr[2];
@@ -208,13 +587,59 @@ namespace h16 {
      */
     InstrTable instr_table;
 
+    template<TraceMode TM> void trace_instr(uint16_t instr,
+                                            uint16_t dmc_addr,
+                                            int16_t dmc_data,
+                                            bool dmc_erl);
+
+    /*
+     * Decode cache for the BLOCK engine, one entry per word of
+     * core. An entry holds the handler for the instruction in
+     * that word and, for a memory reference, its addressing
+     * mode. For a direct reference y holds the offset in the
+     * sector, the current one or sector zero (whose base depends
+     * on the mode). Indexing then adds X; an indirect reference
+     * goes straight to the indirect chain.
+     */
+    struct Decoded {
+      InstrTable::ExecFunc_pt exec;
+      uint16_t instr;
+      uint16_t y;     // effective address, or its offset
+      uint8_t flags;
+    };
+    static const uint8_t D_VALID       = 0x01;
+    static const uint8_t D_DIRECT      = 0x02; // Memory reference, not indirect
+    static const uint8_t D_SECTOR_ZERO = 0x04; // y is offset in sector zero
+    static const uint8_t D_INDEXED     = 0x08; // Add X
+    static const uint8_t D_INDIRECT    = 0x10; // Follow the indirect chain
+    static const uint8_t D_EA          = (D_DIRECT | D_SECTOR_ZERO |
+                                          D_INDEXED | D_INDIRECT);
+    static const unsigned MAX_BLOCK_LENGTH = 64;
+
+    Engine engine;
+    std::vector<Decoded> decoded;
+
+    void decode_block(uint16_t addr);
+    template<TraceMode TM, bool CHECKS> uint64_t run_blocks(const Decoded *d,
+                                                            uint64_t count,
+                                                            const volatile uint64_t &deadline);
+    void invalidate_decoded();
+
+    void save_registers(SnapshotWriter &w);
+
     uint16_t e_a(uint16_t instr);
+    template<bool EA_ALLOWED> uint16_t e_a_t(uint16_t instr);
+    template<bool EA_ALLOWED> uint16_t e_a_indirect();
 
+    void select_break();
+    void enable_pending();
 
     void increment_p(uint16_t n = 1);
     void write_prt(unsigned int n, uint16_t v);
 
     bool optimize_io_poll(uint16_t instr);
+    uint16_t idle_keys();
+    uint64_t skip_idle(uint64_t count, uint64_t deadline);
 
     static int16_t ex_sc(uint16_t instr);
 
@@ -223,6 +648,11 @@ namespace h16 {
     static int16_t short_adc(int16_t a, int16_t m, bool &c);
     static int32_t multiply(int16_t &ra, int16_t &rb, int16_t rm, int16_t &sc);
     static unsigned divide(int16_t &ra, int16_t &rb, int16_t rm, int16_t &sc, bool &cbitf);
+    static int32_t multiply_microcode(int16_t &ra, int16_t &rb, int16_t rm, int16_t &sc);
+    static unsigned divide_microcode(int16_t &ra, int16_t &rb, int16_t rm, int16_t &sc, bool &cbitf);
+#ifdef TEST_MULTIPLY_DIVIDE
+    static void test_multiply_divide();
+#endif
   
     void unimplemented(uint16_t instr);
 
@@ -356,6 +786,7 @@ namespace h16 {
 #endif
     void generic_group_A(uint16_t instr);
 #ifdef TEST_GENERIC_GROUP_A
+    void generic_group_A_microcode(uint16_t instr);
     void test_generic_group_A();
 #endif
   };
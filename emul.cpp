@@ -29,6 +29,7 @@
 #include "proc.hpp"
 #include "instr.hpp"
 #include "monitor.hpp"
+#include "job_server.hpp"
 
 #ifdef ENABLE_GUI
 #include "gtk/fp.h"
@@ -42,6 +43,12 @@
  * is in a tight loop. */
 #define FP_UPDATE 9753
 
+/* INPUT_WAIT_MS is the longest (in milliseconds) that text mode
+ * blocks waiting for terminal input when the machine can do
+ * nothing until there is some. Input ends the wait at once, so
+ * this only bounds how long anything else can go unnoticed. */
+#define INPUT_WAIT_MS 1000
+
 using namespace h16;
 
 #ifdef ENABLE_GUI
@@ -53,9 +60,7 @@ using namespace h16;
 
 static void fp_run(struct FP_INTF *intf) {
   Proc *p = (Proc *) intf->data;
-  bool monitor_flag = 0;
   bool run = intf->running;
-  int count = FP_UPDATE;
 
   /*
    * If a start button interrupt has been
@@ -73,19 +78,21 @@ static void fp_run(struct FP_INTF *intf) {
   if (intf->mode == FPM_MA) {
     p->mem_access(intf->p_not_pp1, intf->store);
   } else {
-    if (intf->mode == FPM_SI) {
-      count = 1;
-    }
-    
     /*
      * Do machine instructions until the count
-     * expires, or the run flag is cleared (eg/ because
+     * expires, or the processor halts (eg/ because
      * of a HLT instruction) or the monitor is
      * called for
      */
-    while ((count--) && (run || (intf->mode == FPM_SI))
-           && (!monitor_flag)) {
-      p->do_instr(run, monitor_flag);
+    if (intf->mode == FPM_SI) {
+      (void) p->run_until(1);
+    } else if (run) {
+      Proc::StopReason reason = p->run_until(FP_UPDATE);
+      // A breakpoint stops the machine, as the STOP button would
+      run = ((reason != Proc::StopReason::HALT) &&
+             (reason != Proc::StopReason::BREAK));
+      // Let the front panel stop calling us flat out
+      intf->waiting = (reason == Proc::StopReason::WAIT);
     }
     
     int exit_code;
@@ -120,12 +127,85 @@ static bool special_chars(void *callback_arg, int k) {
   return r;
 }
 
+/*
+ * Text mode: let the monitor process commands (from the script,
+ * then the terminal) and run the machine whenever it says so,
+ * until it says to quit or exit is called. Returns whether exit
+ * was called.
+ */
+static bool run_text(Proc *p, Monitor *m, std::ifstream &is, int &exit_code) {
+  bool run = 0;
+  bool exit_called = false;
+
+  m->do_commands(run, is);
+
+  /*
+   * The monitor will return when the processor is to
+   * 'run', or to quit the program. While the processor
+   * is running simulate instructions, and when the
+   * processor stops (or ALT-M is pressed) call the
+   * monitor again
+   */
+
+  while (run) {
+    Proc::StopReason reason;
+    do {
+      reason = p->run_until(UINT64_MAX);
+      if (reason == Proc::StopReason::WAIT)
+        StdTty::wait(INPUT_WAIT_MS);
+    } while ((reason == Proc::StopReason::BUDGET) ||
+             (reason == Proc::StopReason::WAIT));
+    run = (reason != Proc::StopReason::HALT);
+
+    exit_called = p->get_exit_called(exit_code);
+    if (exit_called) {
+      fprintf(((exit_code==0) ? stdout : stderr),
+              PRIu64 ": vsim exit code = %d\n", p->get_half_cycles(), exit_code);
+    } else {
+      m->do_commands(run, is);
+    }
+  }
+
+  return exit_called;
+}
+
+/*
+ * Job server: run the setup script, then each job's script in a
+ * child process that starts with the machine as the setup left it.
+ * Returns in the server when it stops, or in a child when its job
+ * is done.
+ */
+static void serve_jobs(Proc *p, Monitor *m, std::ifstream &is,
+                       const char *socket_name, int &exit_code) {
+  JobServer server;
+
+  m->set_batch(true);
+  if (run_text(p, m, is, exit_code))
+    return;
+
+  if (!server.open(socket_name)) {
+    exit_code = 1;
+    return;
+  }
+
+  std::string script;
+  if (server.next_job(script)) {
+    std::ifstream js(script);
+
+    if (js) {
+      (void) run_text(p, m, js, exit_code);
+    } else {
+      std::cerr << "Could not open <" << script << "> for reading" << std::endl;
+      exit_code = 1;
+    }
+  }
+}
+
 /*
  * Where it all starts...
  */
 int main(int argc, char **argv) {
   int exit_code = 0;
-  bool exit_called = false;
 #ifdef ENABLE_GUI
   bool front_panel = 1;
 #endif
@@ -134,7 +214,7 @@ int main(int argc, char **argv) {
   if ((argc>arg) &&
       ((strncmp(argv[arg], "-h", 2)==0) ||
        (strncmp(argv[arg], "--h", 3)==0))) {
-    printf("Usage: %s [-h|--h] [-t [<script-file]]\n", argv[0]);
+    printf("Usage: %s [-h|--h] [-t] [-T off|pc|full] [-R entries] [-S trace-file] [-E interp|block] [-P off|rate] [-r snapshot-file] [-J socket | -j socket] [<script-file>]\n", argv[0]);
     printf("     : [-h|--h] Prints this help\n");
     printf("     : -t Selects text-only mode. %s\n",
 #ifdef ENABLE_GUI
@@ -143,6 +223,15 @@ int main(int argc, char **argv) {
            "(Assumed, because compiled without GUI support)"
 #endif
            );
+    printf("     : -T Selects the instruction trace mode (default full)\n");
+    printf("     : -R Sets the number of instruction trace entries (default %u)\n",
+           CPU::DEFAULT_TRACE_ENTRIES);
+    printf("     : -S Streams a binary instruction trace to a file (see h16-trace)\n");
+    printf("     : -E Selects the execution engine (default interp)\n");
+    printf("     : -P Paces the machine at rate times real time (default off)\n");
+    printf("     : -r Restores the machine from a snapshot file (see \"save\")\n");
+    printf("     : -J Runs the script, then serves jobs on a Unix socket (implies -t)\n");
+    printf("     : -j Runs the script as a job on the server at a Unix socket\n");
     printf("     : type \"help\" at \"MON>\" prompt in text-only mode for help on script file commands\n");
     
     exit(0);
@@ -160,8 +249,79 @@ int main(int argc, char **argv) {
 #endif
     arg++;
   }
+
+  /*
+   * Trace, engine, pacing, snapshot and job options
+   */
+  CPU::TraceMode trace_mode = CPU::TraceMode::FULL;
+  unsigned long trace_entries = CPU::DEFAULT_TRACE_ENTRIES;
+  const char *trace_file = 0;
+  CPU::Engine engine = CPU::Engine::INTERP;
+  double pace = 0.0;
+  const char *snapshot_file = 0;
+  const char *server_socket = 0;
+  const char *submit_socket = 0;
+  bool parsing_args = true;
+
+  while (parsing_args && (argc>(arg+1))) {
+    if (strcmp(argv[arg], "-T")==0) {
+      if (!CPU::parse_trace_mode(argv[arg+1], trace_mode)) {
+        std::cerr << "Bad trace mode <" << argv[arg+1] << ">" << std::endl;
+        exit(1);
+      }
+      arg += 2;
+    } else if (strcmp(argv[arg], "-R")==0) {
+      trace_entries = strtoul(argv[arg+1], 0, 0);
+      if ((trace_entries == 0) || (trace_entries > CPU::MAX_TRACE_ENTRIES)) {
+        std::cerr << "Bad number of trace entries <" << argv[arg+1] << ">" << std::endl;
+        exit(1);
+      }
+      arg += 2;
+    } else if (strcmp(argv[arg], "-S")==0) {
+      trace_file = argv[arg+1];
+      arg += 2;
+    } else if (strcmp(argv[arg], "-E")==0) {
+      if (!CPU::parse_engine(argv[arg+1], engine)) {
+        std::cerr << "Bad engine <" << argv[arg+1] << ">" << std::endl;
+        exit(1);
+      }
+      arg += 2;
+    } else if (strcmp(argv[arg], "-P")==0) {
+      if (!Proc::parse_pace(argv[arg+1], pace)) {
+        std::cerr << "Bad pace <" << argv[arg+1] << ">" << std::endl;
+        exit(1);
+      }
+      arg += 2;
+    } else if (strcmp(argv[arg], "-r")==0) {
+      snapshot_file = argv[arg+1];
+      arg += 2;
+    } else if (strcmp(argv[arg], "-J")==0) {
+      server_socket = argv[arg+1];
+      arg += 2;
+    } else if (strcmp(argv[arg], "-j")==0) {
+      submit_socket = argv[arg+1];
+      arg += 2;
+    } else {
+      parsing_args = false;
+    }
+  }
+
+  /*
+   * Submitting a job needs none of the machine
+   */
+  if (submit_socket) {
+    if (argc <= arg) {
+      std::cerr << "-j needs a script file" << std::endl;
+      exit(1);
+    }
+    exit(JobServer::submit(submit_socket, argv[arg]));
+  }
   
 #ifdef ENABLE_GUI
+  if (server_socket) {
+    front_panel = 0;
+  }
+
   /* Let GTK look at the options */
   if (front_panel) {
     process_args(&argc, &argv);
@@ -181,6 +341,15 @@ int main(int argc, char **argv) {
    */
   StdTty &stdtty {StdTty::getInstance()};
   Proc *p = new Proc(true);
+  p->set_trace(trace_mode, trace_entries);
+  p->set_engine(engine);
+  p->set_pace(pace);
+  if ((trace_file) && (!p->set_trace_file(trace_file))) {
+    exit(1);
+  }
+  if ((snapshot_file) && (!p->restore_snapshot(snapshot_file))) {
+    exit(1);
+  }
   stdtty.register_callback(static_cast<void *>(p), special_chars);
 
 #ifdef ENABLE_GUI
@@ -197,14 +366,12 @@ int main(int argc, char **argv) {
     intf->master_clear = fp_master_clear;
     
     setup_fp(intf);
-    exit_called = p->get_exit_called(exit_code);
+    (void) p->get_exit_called(exit_code);
   } else {
 #endif
     /*
      * This is the text-based version
      */
-    bool run = 0;
-    bool monitor_flag = 0;
     Monitor *m;
     std::ifstream is;
     
@@ -225,31 +392,18 @@ int main(int argc, char **argv) {
         exit(1);
       }
     }
-    m->do_commands(run, is);
-    
-    /*
-     * The monitor will return when the processor is to
-     * 'run', or to quit the program. While the processor
-     * is running simulate instructions, and when the
-     * processor stops (or ALT-M is pressed, setting
-     * monitor_flag) call the monitor again
-     */
-    
-    while (run) {
-      while (run && (!monitor_flag)) {
-        p->do_instr(run, monitor_flag);
-      }
-      exit_called = p->get_exit_called(exit_code);
-      if (exit_called) {
-        fprintf(((exit_code==0) ? stdout : stderr),
-                PRIu64 ": vsim exit code = %d\n", p->get_half_cycles(), exit_code);
-      } else {
-        monitor_flag = 0;
-        m->do_commands(run, is);
-      }
+
+    if (server_socket) {
+      serve_jobs(p, m, is, server_socket, exit_code);
+    } else {
+      (void) run_text(p, m, is, exit_code);
     }
 #ifdef ENABLE_GUI
   }
 #endif
+
+  // Flush any streaming trace
+  (void) p->close_trace_file();
+
   exit(exit_code);
 }
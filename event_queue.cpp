@@ -19,44 +19,60 @@
  */
 #include "event_queue.hpp"
 
+#include <algorithm>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
 #include <sstream>
 
 #include "p_to_io_intf.hpp"
 #include "io_to_p_intf.hpp"
+#include "snapshot.hpp"
 
 EventQueue::EventQueue(IoToPIntf &p)
   : p(p)
+  , seq(0)
+  , deadline(NO_EVENT)
+  , dispatched()
+  , high_water(0)
 {
+  heap.reserve(RESERVED_EVENTS);
 }
 
 void EventQueue::queue(uint64_t event_time,
                        PToIoIntf &device,
                        int reason)
 {
-  Event ev(device, reason);
-  
-  event_queue.insert(event_queue_t::value_type(event_time, ev));
+  heap.push_back(Event{event_time, seq++, &device, reason});
+  std::push_heap(heap.begin(), heap.end(), std::greater<Event>());
+  if (heap.size() > high_water)
+    high_water = heap.size();
+
+  if (event_time < deadline)
+    deadline = event_time;
 }
 
-bool EventQueue::call_devices(uint64_t event_time)
+bool EventQueue::dispatch(uint64_t event_time)
 {
   unsigned int event_count = 0;
   bool r = false;
 
-  event_queue_t::iterator it = event_queue.begin();
-
-  while ((it != event_queue.end()) && (it->first <= event_time)) {
+  while ((!heap.empty()) && (heap.front().event_time <= event_time)) {
 
     r = true;
-    
-    Event &ev(it->second);
 
-    ev.first.event(ev.second);
-      
-    it = event_queue.erase(it);
-    
+    /*
+     * Remove the event before calling the device, since the
+     * device may well queue further events.
+     */
+    std::pop_heap(heap.begin(), heap.end(), std::greater<Event>());
+    Event ev(heap.back());
+    heap.pop_back();
+    set_deadline();
+
+    dispatched[ev.device->get_id()]++;
+    ev.device->event(ev.reason);
+
     if (++event_count > MAXIMUM_EVENTS) {
       std::stringstream ss;
       ss << "More than " << MAXIMUM_EVENTS << " events at time " << event_time
@@ -64,28 +80,86 @@ bool EventQueue::call_devices(uint64_t event_time)
       p.anomaly(IoToPIntf::Level::FATAL, ss.str());
     }
   }
-  
+
   return r;
 }
 
 void EventQueue::flush_events(uint64_t &event_time)
 {
-  while (!event_queue.empty()) {
-    event_time = event_queue.begin()->first;
-    (void) call_devices(event_time);
+  while (!heap.empty()) {
+    event_time = heap.front().event_time;
+    (void) dispatch(event_time);
   }
 }
 
 void EventQueue::discard_events()
 {
-  event_queue.clear();
+  heap.clear();
+  deadline = NO_EVENT;
+}
+
+void EventQueue::save(h16::SnapshotWriter &w, const DeviceToId &to_id) const
+{
+  w.put64(seq);
+  w.put32(heap.size());
+  for (auto &ev: heap) {
+    w.put64(ev.event_time);
+    w.put64(ev.seq);
+    w.put32(to_id(ev.device));
+    w.put32(ev.reason);
+  }
+}
+
+bool EventQueue::check(h16::SnapshotReader &r, const IdToDevice &to_device)
+{
+  bool ok = true;
+
+  (void) r.get64(); // seq
+
+  const uint32_t n = r.get32();
+  for (uint32_t i=0; r.ok() && (i<n); i++) {
+    (void) r.get64(); // event_time
+    (void) r.get64(); // seq
+    if (!to_device(static_cast<int32_t>(r.get32())))
+      ok = false;
+    (void) r.get32(); // reason
+  }
+
+  return ok && r.ok();
+}
+
+bool EventQueue::restore(h16::SnapshotReader &r, const IdToDevice &to_device)
+{
+  bool ok = true;
+
+  heap.clear();
+  seq = r.get64();
+
+  const uint32_t n = r.get32();
+  for (uint32_t i=0; r.ok() && (i<n); i++) {
+    Event ev;
+    ev.event_time = r.get64();
+    ev.seq = r.get64();
+    ev.device = to_device(static_cast<int32_t>(r.get32()));
+    ev.reason = static_cast<int32_t>(r.get32());
+    if (ev.device)
+      heap.push_back(ev);
+    else
+      ok = false;
+  }
+
+  // Saved in heap order, but make sure
+  std::make_heap(heap.begin(), heap.end(), std::greater<Event>());
+  set_deadline();
+
+  return ok && r.ok();
 }
 
 bool EventQueue::next_event_time(uint64_t &event_time)
 {
   bool r = false;
-  if (!event_queue.empty()) {
-    event_time = event_queue.begin()->first;
+  if (!heap.empty()) {
+    event_time = heap.front().event_time;
     r = true;
   }
   return r;
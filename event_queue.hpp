@@ -22,30 +22,102 @@
 #define _EVENT_QUEUE_HPP_
 
 #include <cstdint>
-#include <map>
+#include <vector>
+#include <functional>
+#include <array>
 
 class IoToPIntf;
 class PToIoIntf;
 
+namespace h16 {
+  class SnapshotWriter;
+  class SnapshotReader;
+}
+
+/*
+ * Pending device events, ordered by half-cycle time.
+ *
+ * Events are kept in a binary min-heap held in a vector whose
+ * storage is reserved up front, so queueing an event does not
+ * allocate. Each event carries a sequence number so that events
+ * queued for the same time are delivered in the order they were
+ * queued. The time of the earliest event is cached in deadline
+ * so that call_devices() is a single compare when nothing is due.
+ */
 class EventQueue
 {
 public:
   EventQueue(IoToPIntf &p);
 
   void queue(uint64_t event_time, PToIoIntf &device, int reason = 0);
-  bool call_devices(uint64_t event_time);
+  bool call_devices(uint64_t event_time)
+  {
+    if (event_time < deadline)
+      return false;
+    return dispatch(event_time);
+  }
   void flush_events(uint64_t &event_time);
   void discard_events();
   bool next_event_time(uint64_t &event_time);
-  
+
+  /*
+   * Time of the earliest pending event, or NO_EVENT if the
+   * queue is empty
+   */
+  uint64_t get_deadline() const { return deadline; }
+  static const uint64_t NO_EVENT = UINT64_MAX;
+
+  /*
+   * Statistics: events dispatched to each device, indexed by
+   * its ID (PToIoIntf::get_id(); the I/O addresses, then the
+   * MFM), and the most ever pending at once
+   */
+  static const int DEVICE_IDS = 0101;
+  typedef std::array<uint64_t, DEVICE_IDS> DispatchCounts;
+  const DispatchCounts &get_dispatched() const { return dispatched; }
+  size_t get_high_water() const { return high_water; }
+  void clear_stats() { dispatched.fill(0); high_water = heap.size(); }
+
+  /*
+   * Snapshots. Devices are saved as small numbers, converted
+   * by the functions given; check and restore return false if
+   * any of them is not known (check changes nothing).
+   */
+  typedef std::function<int(const PToIoIntf *)> DeviceToId;
+  typedef std::function<PToIoIntf *(int)> IdToDevice;
+  void save(h16::SnapshotWriter &w, const DeviceToId &to_id) const;
+  static bool check(h16::SnapshotReader &r, const IdToDevice &to_device);
+  bool restore(h16::SnapshotReader &r, const IdToDevice &to_device);
+
 private:
   IoToPIntf &p;
-  
-  typedef std::pair<PToIoIntf &, int> Event;
-  typedef std::multimap<uint64_t, Event> event_queue_t;
-  event_queue_t event_queue;
-  
+
+  struct Event {
+    uint64_t event_time;
+    uint64_t seq;
+    PToIoIntf *device;
+    int reason;
+
+    // Heap ordering - "greater" puts the earliest event at the top
+    bool operator>(const Event &o) const {
+      return (event_time > o.event_time) ||
+        ((event_time == o.event_time) && (seq > o.seq));
+    }
+  };
+
+  std::vector<Event> heap;
+  uint64_t seq;
+  uint64_t deadline;
+  DispatchCounts dispatched;
+  size_t high_water;
+
+  bool dispatch(uint64_t event_time);
+  void set_deadline() {
+    deadline = heap.empty() ? NO_EVENT : heap.front().event_time;
+  }
+
   static const unsigned int MAXIMUM_EVENTS = 10000;
+  static const unsigned int RESERVED_EVENTS = 256;
 };
 
 #endif // _EVENT_QUEUE_HPP_
@@ -50,6 +50,7 @@ struct FP_INTF *h16::CPU::fp_intf()
   intf->p_not_pp1=0;
 
   intf->running=run;
+  intf->waiting=0;
 
   intf->start_button_interrupt_pending=0;
   intf->power_fail_interrupt_pending=0;
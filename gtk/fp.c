@@ -25,6 +25,9 @@
 #include "fp.h"
 #include "menu.h"
 
+/* How often (ms) to look at a machine that is waiting for input */
+#define RUN_WAIT_MS 20
+
 static char *reg_names[RB_NUM] =
   {  "X", "A", "B", "OP", "P/Y", "M" };
 
@@ -45,6 +48,7 @@ struct FRONT_PANEL
   short *saved_pointers[RB_NUM];
 
   gint run_idle_tag;
+  int run_waiting; /* run_idle_tag is a timeout, not an idle */
   GtkWidget *start_button;
 
   int power;
@@ -624,6 +628,25 @@ static int run_idle_function (gpointer data)
   if (fp->intf->exit_called) {
     gtk_main_quit();
   }
+
+  /*
+   * While the machine is only waiting for input don't call it
+   * flat out from an idle function; look again every
+   * RUN_WAIT_MS instead, and go back to the idle function as
+   * soon as it has something to do.
+   */
+  if ((fp->intf->running) && (fp->intf->waiting != fp->run_waiting))
+    {
+      fp->run_waiting = fp->intf->waiting;
+      if (fp->run_waiting)
+        fp->run_idle_tag = g_timeout_add( RUN_WAIT_MS,
+                                          (GSourceFunc) run_idle_function,
+                                          (gpointer) fp );
+      else
+        fp->run_idle_tag = g_idle_add( (GSourceFunc) run_idle_function,
+                                       (gpointer) fp );
+      return FALSE;
+    }
   
   return fp->intf->running;
 }
@@ -653,7 +676,9 @@ static void start_callback (GtkWidget *widget, gpointer data)
       if ((fp->intf->mode == FPM_RUN) && (fp->power))
         {
           fp->intf->running = 1;
+          fp->intf->waiting = 0;
           fp->intf->start_button_interrupt_pending = 1;
+          fp->run_waiting = 0;
           fp->run_idle_tag = g_idle_add( (GSourceFunc) run_idle_function,
                                          (gpointer) fp );
         }
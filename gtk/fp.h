@@ -88,6 +88,11 @@ struct FP_INTF
   int running;
   int exit_called;
 
+  /*
+   * Is the running machine just waiting for input?
+   */
+  int waiting;
+
   int start_button_interrupt_pending;
   int power_fail_interrupt_pending;
   int power_fail_interrupt_acknowledge;
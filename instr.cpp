@@ -19,7 +19,9 @@
  */
 #include "instr.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <string_view>
 #include <iostream>
 #include <format>
 
@@ -33,24 +35,14 @@ class CPU;
 
 using namespace h16;
 
-InstrTable::Instr::Instr(const std::string &mnemonic,
-                         INSTR_TYPE type,
-                         uint16_t opcode,
-                         const std::string &description,
-                         ExecFunc_pt exec)
-  : mnemonic(mnemonic),
-    type(type),
-    opcode(opcode),
-    description(description),
-    exec(exec) {
-}
-
 const std::string InstrTable::Instr::disassemble(uint16_t addr,
                                                  uint16_t instr,
                                                  bool brk,
                                                  uint16_t y,
-                                                 bool y_valid) const {
+                                                 bool y_valid,
+                                                 bool alias) const {
   std::string s;
+  std::string m = alias ? std::format("({})", mnemonic) : std::string(mnemonic);
   
   if (brk) {
     s += "break: ";
@@ -70,23 +62,23 @@ const std::string InstrTable::Instr::disassemble(uint16_t addr,
     s += std::format("{:c}{:1o} {:0>2o} {:0>4o} {}{:c} {}",
                      ((instr & 0x8000)?'-':' '),
                      ((instr>>14) & 1), ((instr >> 10) & 0xf),
-                     (instr & 0x3ff), mnemonic,
+                     (instr & 0x3ff), m,
                      ((instr & 0x8000)?'*':' '),
                      str_ea(addr, instr, y, y_valid));
     break;
   case SH:
     s += std::format(" {:0>4o} {:0>2o}   {}  '{:0>2o}",
             ((instr>>6) & 0x3ff), (instr & 0x3f),
-            mnemonic.c_str(),
+            m,
             static_cast<int>(-ex_sc(instr)));    
     break;
   case IO:
     s += std::format(" {:0>2o} {:0>4o}   {}  '{:0>4o}",
             ((instr>>10) & 0x3f), (instr & 0x3ff),
-            mnemonic.c_str(), (instr & 0x3ff));
+            m, (instr & 0x3ff));
     break;
   default:
-    s += std::format(" {:0>6o}    {}", instr, mnemonic);
+    s += std::format(" {:0>6o}    {}", instr, m);
     break;
   }
 
@@ -159,7 +151,7 @@ std::string InstrTable::Instr::str_ea(uint16_t addr,
 
 #define IT(t) InstrTable::Instr::t
 
-const InstrTable::InstrTable_t InstrTable::standard {
+constexpr InstrTable::Instr InstrTable::standard[] = {
   Instr("CRA", IT(GA), 0140040, "Clear A", PD(do_CRA)),
   Instr("IAB", IT(GB), 0000201, "Interchange A and B", PD(do_IAB)),
   Instr("IMA", IT(MR), 013,     "Interchange memory and A", PD(do_IMA)),
@@ -234,20 +226,20 @@ const InstrTable::InstrTable_t InstrTable::standard {
   Instr("ICR", IT(GA), 0141240, "Interchange and clear right half of A", PD(do_ICR)),
 };
 
-const InstrTable::InstrTable_t InstrTable::ea {
+constexpr InstrTable::Instr InstrTable::ea[] = {
   Instr("DXA", IT(GB), 0000011, "Disable Extended Mode", PD(do_DXA)),
   Instr("EXA", IT(GB), 0000013, "Enable Extended Mode", PD(do_EXA)),
 };
 
-const InstrTable::InstrTable_t InstrTable::ml {
+constexpr InstrTable::Instr InstrTable::ml[] = {
   Instr("ERM", IT(GB), 0001401, "Enter Restrict Mode", PD(do_ERM)),
 };
 
-const InstrTable::InstrTable_t InstrTable::mp {
+constexpr InstrTable::Instr InstrTable::mp[] = {
   Instr("RMP", IT(GB), 0000021, "Reset memory parity error", PD(do_RMP)),
 };
 
-const InstrTable::InstrTable_t InstrTable::hsa {
+constexpr InstrTable::Instr InstrTable::hsa[] = {
   Instr("DBL", IT(GB), 0000007, "Enter Double Precision Mode", PD(do_DBL)),
   Instr("DIV", IT(MR), 017,     "Divide", PD(do_DIV)),
   Instr("MPY", IT(MR), 016,     "Multiply", PD(do_MPY)),
@@ -267,7 +259,7 @@ const InstrTable::InstrTable_t InstrTable::hsa {
  * trace file is more use with these mnemonics! Might need to
  * revert to this older method...
  */
-const InstrTable::InstrTable_t InstrTable::NPL_group_a {
+constexpr InstrTable::Instr InstrTable::NPL_group_a[] = {
   Instr("ad1", IT(GA), 0140042, "Add one without setting overflow", PD(do_ad1)),
   Instr("ad1", IT(GA), 0140443, "Add one without setting overflow", PD(do_ad1_15)),
   Instr("adc", IT(GA), 0140453, "Add C without setting overflow", PD(do_adc_15)),
@@ -300,343 +292,178 @@ const InstrTable::InstrTable_t InstrTable::NPL_group_a {
 };
 #endif
 
-const std::vector<InstrTable::InstrTable_t> InstrTable::instr_tables {
-  standard,
-  ea,
-  ml,
-  mp,
-  hsa,
-#if ((!defined(GENERIC_GROUP_A)) || defined(TEST_GENERIC_GROUP_A))
-  NPL_group_a,
-#endif
-};
-
-InstrTable::InstrTable()
-  : instructions( (1<<16), uimp) 
-{
-  build_instr_tables();
-}
-
-void InstrTable::build_one_instr_table(const InstrTable_t &itable) {
-  unsigned long i=0;
-  int ind, t, s, addr, t0, t1;
-
-  for (auto &ip: itable) {
-
-    mnemonic_to_instr[ip.mnemonic] = &ip;
-    
-    switch(ip.type) {
-      
-    case Instr::GB: // Generic type B
-    case Instr::SK: // Skip
-    case Instr::GA: // Generic type A
-    case Instr::IG: // IO instuction pretending to be Generic
-      instructions[ip.opcode] = ip;
-      break;
-          
-    case Instr::SH: // Shift
-      for (addr=0; addr<64; addr++) {
-        i = (ip.opcode << 6) | (addr & 0x03f);
-        instructions[i] = ip;
-      }
-      break;
-          
-    case Instr::MR: // Memory reference
-      for (ind=0; ind < 2; ind++) {
-        for (addr=0; addr<512; addr++) {
-          for (s=0; s<2; s++) {
-            if (ip.opcode & 0x20) { // STX/LDX
-              t0=t1=(ip.opcode >> 4) & 1;
-            } else {
-              t0=0; t1=1;
-            }
-            for (t=t0; t<=t1; t++) {
-              i = ((ind & 1) << 15) |
-                ((t & 1) << 14) |
-                ((ip.opcode & 0x0f) << 10) |
-                ((s & 1) << 9) |
-                (addr & 0777);
-              instructions[i] = ip;
-            }
-          }
-        }
-      }
-      break;
-          
-    case Instr::IO: // IO intructions
-      for (addr=0; addr<1024; addr++) {
-        i = ((ip.opcode & 0x3f) << 10) | (addr & 0x3ff);
-        if ((ip.opcode & 077) == 074) { // OTA or SMK
-          if (((addr &0x3f) == 020) || ((addr &0x3f) == 024)) {
-            // device code is SMK
-            if (i != 0171020) { // OTK
-              if (ip.opcode & 0x40) {
-                // opcode is flagged as SMK too 
-                instructions[i] = ip;
-              }
-            }
-          } else {
-            // device code is OTA
-            if (!(ip.opcode & 0x40)) {
-              instructions[i] = ip;
-            }
-          }
-        } else {
-          instructions[i] = ip;
-        }
-      }
-      break;
-
-    default: abort(); break;
-    } 
-  }
-}
-
-const InstrTable::Instr InstrTable::uimp {
+constexpr InstrTable::Instr InstrTable::uimp {
   "???",   IT(UD), 0, "Unimplemented",   PD(unimplemented)
 };
-const InstrTable::Instr InstrTable::gskp {
+constexpr InstrTable::Instr InstrTable::gskp {
   "skip?", IT(SH), 0, "Generic skip",    PD(generic_skip)
 };
-const InstrTable::Instr InstrTable::gshf {
+constexpr InstrTable::Instr InstrTable::gshf {
   "shft?", IT(SH), 0, "Generic shift",   PD(generic_shift)
 };
-const InstrTable::Instr InstrTable::gena {
+constexpr InstrTable::Instr InstrTable::gena {
   "gnrc?", IT(SH), 0, "Generic group A", PD(generic_group_A)
 };
 
-
-void InstrTable::build_instr_tables()
-{
-  for (auto &t: instr_tables) {
-    build_one_instr_table(t);
-  }
-
-#if ((!defined(GENERIC_GROUP_A)) || defined(TEST_GENERIC_GROUP_A))
-  //
-  // Many Group A instructions have alternate opcodes that
-  // produce the same actions
-  //
-  apply_aliases();
-#endif
-
-  //
-  // Now deal with the instructions that we have the ability
-  // to deal with as groups; so that "microcoding" of the
-  // machine works right. Acording to 
-  // "Micro-coding the DDP-516 computer, Donald A Bell
-  //  NPL Com. Sci. T.M. 54 April 1971"
-  //
-
-  // Skip...
-  for (unsigned i=0x8000; i<0x8400; i++)
-    if (instructions[i].type == Instr::UD)
-      instructions[i] = gskp;
-
-  // Shift...
-  for (unsigned i=0x4000; i<0x4400; i++)
-    if (instructions[i].type == Instr::UD)
-      instructions[i] = gshf;
-
-  // Generic group A...
-  for (unsigned i=0xc000; i<0xc400; i++)
-    if (instructions[i].type == Instr::UD)
-      instructions[i] = gena;
-
-  dispatch_table.clear();
-  for (auto &ip: instructions) {
-    dispatch_table.push_back(ip.exec);
-  }
-}
-
-
-const std::string InstrTable::disassemble(uint16_t addr,
-                                          uint16_t instr,
-                                          bool brk,
-                                          uint16_t y,
-                                          bool y_valid) const
-{
-  return instructions[instr].disassemble(addr, instr, brk, y, y_valid);
-}
-
-const InstrTable::Instr *InstrTable::lookup(const std::string &mnemonic) const
-{
-  std::map<std::string, const Instr *>::const_iterator it = mnemonic_to_instr.find(mnemonic);
-  if (it == mnemonic_to_instr.end()) {
-    return nullptr;
-  } else {
-    return it->second;
-  }
-}
-
-void InstrTable::dump_instructions() const
-{
-  for (unsigned i=0; i<65536; i++) {
-    std::cout << std::format("{:0>6o} {}\n", i, instructions[i].mnemonic);
-  }
-}
-
 #if ((!defined(GENERIC_GROUP_A)) || defined(TEST_GENERIC_GROUP_A))
 
-const InstrTable::AliasTable_t InstrTable::HLT_alias = {
+static constexpr uint16_t HLT_alias[] = {
   0000000, 0000002, 0000012
 }; 
-const InstrTable::AliasTable_t InstrTable::CMA_alias {
+static constexpr uint16_t CMA_alias[] = {
   0140001, 0140003, 0140005, 0140007, 0140011, 0140013, 0140015, 0140017,
   0140021, 0140022, 0140023, 0140025, 0140026, 0140027, 0140031, 0140032,
   0140033, 0140035, 0140036, 0140037, 0140101, 0140103, 0140105, 0140107,
   0140111, 0140113, 0140115, 0140117, 0140401, 0140405, 0140411, 0140415,
   0140421, 0140425, 0140431, 0140435, 0140501, 0140505, 0140511, 0140515
 };
-const InstrTable::AliasTable_t InstrTable::CRA_alias {
+static constexpr uint16_t CRA_alias[] = {
   0140002, 0140006, 0140040, 0140060, 0140102, 0140106, 0140440, 0140460
 };
-const InstrTable::AliasTable_t InstrTable::SSM_alias {
+static constexpr uint16_t SSM_alias[] = {
   0140004, 0140014, 0140104, 0140114, 0140404, 0140414, 0140500, 0140504,
   0140510, 0140514
 };
-const InstrTable::AliasTable_t InstrTable::CHS_alias {
+static constexpr uint16_t CHS_alias[] = {
   0140024, 0140034, 0140424, 0140434
 };
-const InstrTable::AliasTable_t InstrTable::InstrTable::CAR_alias {
+static constexpr uint16_t CAR_alias[] = {
   0140044, 0140064, 0140444, 0140464
 };
-const InstrTable::AliasTable_t InstrTable::CAL_alias {
+static constexpr uint16_t CAL_alias[] = {
   0140050, 0140070, 0140450, 0140470
 };
-const InstrTable::AliasTable_t InstrTable::SSP_alias {
+static constexpr uint16_t SSP_alias[] = {
   0140100, 0140110
 };
-const InstrTable::AliasTable_t InstrTable::ICL_alias {
+static constexpr uint16_t ICL_alias[] = {
   0140140
 };
-const InstrTable::AliasTable_t InstrTable::ICR_alias {
+static constexpr uint16_t ICR_alias[] = {
   0140240, 0140260
 };
-const InstrTable::AliasTable_t InstrTable::RCB_alias {
+static constexpr uint16_t RCB_alias[] = {
   0140200, 0140201, 0140203, 0140204, 0140205, 0140207, 0140210, 0140211,
   0140213, 0140214, 0140215, 0140217, 0140220, 0140221, 0140222, 0140223,
   0140224, 0140225, 0140226, 0140227, 0140230, 0140231, 0140232, 0140233,
   0140234, 0140235, 0140236, 0140237, 0140301, 0140303, 0140304, 0140305,
   0140307, 0140311, 0140313, 0140314, 0140315, 0140317
 };
-const InstrTable::AliasTable_t InstrTable::CSA_alias {
+static constexpr uint16_t CSA_alias[] = {
   0140320, 0140330
 };
-const InstrTable::AliasTable_t InstrTable::TCA_alias {
+static constexpr uint16_t TCA_alias[] = {
   0140403, 0140407, 0140422, 0140423, 0140426, 0140427, 0140503, 0140507
 };
-const InstrTable::AliasTable_t InstrTable::ICA_alias {
+static constexpr uint16_t ICA_alias[] = {
   0140340
 };
-const InstrTable::AliasTable_t InstrTable::SCB_alias {
+static constexpr uint16_t SCB_alias[] = {
   0140600, 0140601, 0140604, 0140605, 0140610, 0140611, 0140614, 0140615,
   0140620, 0140621, 0140624, 0140625, 0140630, 0140631, 0140634, 0140635,
   0140700, 0140701, 0140704, 0140705, 0140710, 0140711, 0140714, 0140715,
   0140720, 0140721, 0140724, 0140725, 0140730, 0140731, 0140734, 0140735
 };
-const InstrTable::AliasTable_t InstrTable::AOA_alias {
+static constexpr uint16_t AOA_alias[] = {
   0140202, 0140206, 0140302, 0140306
 };
-const InstrTable::AliasTable_t InstrTable::AD1_alias {
+static constexpr uint16_t AD1_alias[] = {
   0140042, 0140046
 };
-const InstrTable::AliasTable_t InstrTable::AD1_15_alias {
+static constexpr uint16_t AD1_15_alias[] = {
   0140443, 0140447, 0140462, 0140463, 0140466, 0140467
 };
-const InstrTable::AliasTable_t InstrTable::ACA_alias {
+static constexpr uint16_t ACA_alias[] = {
   0140212, 0140216, 0140312, 0140316
 };
-const InstrTable::AliasTable_t InstrTable::ADC_alias {
+static constexpr uint16_t ADC_alias[] = {
   0140052, 0140056
 };
-const InstrTable::AliasTable_t InstrTable::ADC_15_alias {
+static constexpr uint16_t ADC_15_alias[] = {
   0140453, 0140457, 0140472, 0140473, 0140476, 0140477
 };
-const InstrTable::AliasTable_t InstrTable::CM1_alias {
+static constexpr uint16_t CM1_alias[] = {
   0140012, 0140016, 0140112, 0140116
 };
-const InstrTable::AliasTable_t InstrTable::LTR_alias {
+static constexpr uint16_t LTR_alias[] = {
   0140144, 0140544
 };
-const InstrTable::AliasTable_t InstrTable::BTR_alias {
+static constexpr uint16_t BTR_alias[] = {
   0140141, 0140143, 0140145, 0140147, 0140151, 0140153, 0140154, 0140155,
   0140157, 0140541, 0140545, 0140551, 0140554, 0140555
 };
-const InstrTable::AliasTable_t InstrTable::BTL_alias {
+static constexpr uint16_t BTL_alias[] = {
   0140241, 0140243, 0140245, 0140247, 0140251, 0140253, 0140254, 0140255,
   0140257, 0140261, 0140262, 0140263, 0140265, 0140266, 0140267, 0140271,
   0140272, 0140273, 0140274, 0140275, 0140276, 0140277
 };
-const InstrTable::AliasTable_t InstrTable::RTL_alias {
+static constexpr uint16_t RTL_alias[] = {
   0140250, 0140270
 };
-const InstrTable::AliasTable_t InstrTable::RCB_SSP_alias {
+static constexpr uint16_t RCB_SSP_alias[] = {
   0140300, 0140310
 };
-const InstrTable::AliasTable_t InstrTable::CPY_alias {
+static constexpr uint16_t CPY_alias[] = {
   0140321, 0140322, 0140323, 0140324, 0140325, 0140326, 0140327, 0140331,
   0140332, 0140333, 0140334, 0140335, 0140336, 0140337
 };
-const InstrTable::AliasTable_t InstrTable::BTB_alias {
+static constexpr uint16_t BTB_alias[] = {
   0140341, 0140343, 0140345, 0140347, 0140351, 0140353, 0140354, 0140355,
   0140357
 };
-const InstrTable::AliasTable_t InstrTable::BCL_alias {
+static constexpr uint16_t BCL_alias[] = {
   0140150
 };
-const InstrTable::AliasTable_t InstrTable::BCR_alias {
+static constexpr uint16_t BCR_alias[] = {
   0140244, 0140264
 };
-const InstrTable::AliasTable_t InstrTable::LD1_alias {
+static constexpr uint16_t LD1_alias[] = {
   0140402, 0140406, 0140502, 0140506
 };
-const InstrTable::AliasTable_t InstrTable::ISG_alias {
+static constexpr uint16_t ISG_alias[] = {
   0140412, 0140416, 0140512, 0140516
 };
-const InstrTable::AliasTable_t InstrTable::CMA_ACA_alias {
+static constexpr uint16_t CMA_ACA_alias[] = {
   0140413, 0140417, 0140432, 0140433, 0140436, 0140437, 0140513, 0140517
 };
-const InstrTable::AliasTable_t InstrTable::CMA_ACA_C_alias {
+static constexpr uint16_t CMA_ACA_C_alias[] = {
   0140532, 0140533, 0140536, 0140537
 };
-const InstrTable::AliasTable_t InstrTable::A2A_alias =
-  {
+static constexpr uint16_t A2A_alias[] = {
     0140442, 0140446
   };
-const InstrTable::AliasTable_t InstrTable::A2C_alias {
+static constexpr uint16_t A2C_alias[] = {
   0140452, 0140456
 };
-const InstrTable::AliasTable_t InstrTable::ICS_alias {
+static constexpr uint16_t ICS_alias[] = {
   0140540
 };
-const InstrTable::AliasTable_t InstrTable::SCB_A2A_alias {
+static constexpr uint16_t SCB_A2A_alias[] = {
   0140602, 0140606, 0140702, 0140706
 };
-const InstrTable::AliasTable_t InstrTable::SCB_AOA_alias {
+static constexpr uint16_t SCB_AOA_alias[] = {
   0140603, 0140607, 0140622, 0140623, 0140626, 0140627, 0140703, 0140707,
   0140722, 0140723, 0140726, 0140727
 };
-const InstrTable::AliasTable_t InstrTable::A2C_SCB_alias =
-  {
+static constexpr uint16_t A2C_SCB_alias[] = {
     //0143612, 0140616, 0140712, 0140716
     0140612, 0140616, 0140712, 0140716
   };
-const InstrTable::AliasTable_t InstrTable::ACA_SCB_alias {
+static constexpr uint16_t ACA_SCB_alias[] = {
   0140613, 0140617, 0140632, 0140633, 0140636, 0140637, 0140713, 0140717,
   0140732, 0140733, 0140736, 0140737
 };
-const InstrTable::AliasTable_t InstrTable::ICR_SCB_alias {
+static constexpr uint16_t ICR_SCB_alias[] = {
   0140640, 0140660
 };
-const InstrTable::AliasTable_t InstrTable::RTL_SCB_alias {
+static constexpr uint16_t RTL_SCB_alias[] = {
   0140650, 0140670
 };
-const InstrTable::AliasTable_t InstrTable::BTB_SCB_alias {
+static constexpr uint16_t BTB_SCB_alias[] = {
   0140741, 0140745, 0140751, 0140754, 0140755, 0140761, 0140765, 0140771,
   0140774, 0140775
 };
-const InstrTable::AliasTable_t InstrTable::NOA_alias {
+static constexpr uint16_t NOA_alias[] = {
   0140000, 0140010, 0140020, 0140030, 0140041, 0140043, 0140045, 0140047,
   0140051, 0140053, 0140054, 0140055, 0140057, 0140061, 0140062, 0140063,
   0140065, 0140066, 0140067, 0140071, 0140072, 0140073, 0140074, 0140075,
@@ -644,7 +471,7 @@ const InstrTable::AliasTable_t InstrTable::NOA_alias {
   0140451, 0140454, 0140455, 0140461, 0140465, 0140471, 0140474, 0140475
 };
 
-const std::vector<InstrTable::AliasTable_t> InstrTable::aliases {
+static constexpr std::span<const uint16_t> aliases[] = {
   HLT_alias,
   CMA_alias,
   CRA_alias,
@@ -693,7 +520,8 @@ const std::vector<InstrTable::AliasTable_t> InstrTable::aliases {
   NOA_alias
 };
 
-void InstrTable::apply_one_alias(const AliasTable_t &alias) {
+consteval void InstrTable::apply_one_alias(Tables &t,
+                                           std::span<const uint16_t> alias) {
   uint16_t limit;
   
   if ((alias[0] & 0140000) == 0140000)
@@ -706,60 +534,245 @@ void InstrTable::apply_one_alias(const AliasTable_t &alias) {
   // list of aliased instructions that has been defined
   // already and check that there is not more than one.
   //
+  // (Throwing here fails the compilation.)
+  //
 
   int proper_i = -1;
   for (uint16_t a: alias) {
-    for (uint16_t i=a; i<=(a+limit); i+=B7) {
-      if (instructions[i].type != Instr::UD) {
+    for (unsigned i=a; i<=(unsigned)(a+limit); i+=B7) {
+      if (t.index[i] != 0) {
         if (proper_i < 0) {
           proper_i = i;
         } else {
-          std::cerr << std::format("This alias spans two instructions ('{:0>6o}): {} and {}",
-                                   i, instructions[proper_i].mnemonic,
-                                   instructions[i].mnemonic) << std::endl;
-          exit(1);
+          throw "This alias spans two instructions";
         }
       }
     }
   }
   
   if (proper_i < 0) {
-    std::cerr << std::format("Failed to find '{:0>6o}", alias[0]) << std::endl;
-    exit(1);
+    throw "Failed to find the instruction for an alias";
   }
 
   //
   // Having established that there is precisely one
-  // "proper" instruction for this alias list create a
-  // string to represent the mnemonic and description
+  // "proper" instruction for this alias list point
+  // the others at it, flagged as alternatives
   //
 
-  std::string temp_mnemonic = "(" + instructions[proper_i].mnemonic + ")";
-  std::string temp_description = "(Alternative) " + instructions[proper_i].description;
-
   for (uint16_t a: alias) {
-    for (uint16_t i=a; i<=(a+limit); i+=B7) {
-      if (i != proper_i) {
+    for (unsigned i=a; i<=(unsigned)(a+limit); i+=B7) {
+      if (i != (unsigned) proper_i) {
         // For all but the proper instruction
-        // replace the "undefined" Instr structure
-        assert(instructions[i].type == Instr::UD);
-
-        instructions[i].mnemonic    = temp_mnemonic;
-        instructions[i].type        = instructions[proper_i].type;
-        instructions[i].opcode      = instructions[proper_i].opcode;
-        instructions[i].description = temp_description;
-        instructions[i].exec        = instructions[proper_i].exec;
+        // replace the "undefined" instruction
+        if (t.index[i] != 0)
+          throw "Alias of an instruction that is already defined";
+
+        t.index[i] = t.index[proper_i];
+        t.alias[i >> 6] |= (uint64_t(1) << (i & 63));
       }
     }
   }
-  
 }
 
+#endif
 
-void InstrTable::apply_aliases()
+consteval uint8_t InstrTable::add_instr(Tables &t, const Instr &ip)
 {
-  for (auto &alias: aliases) 
-    apply_one_alias(alias);
+  if (t.n_instrs >= MAX_INSTRS)
+    throw "Too many instructions for the dispatch table";
+
+  t.instrs[t.n_instrs] = &ip;
+  t.exec[t.n_instrs] = ip.exec;
+  return static_cast<uint8_t>(t.n_instrs++);
+}
+
+consteval void InstrTable::build_one_instr_table(Tables &t,
+                                                 std::span<const Instr> itable) {
+  unsigned long i=0;
+  int ind, tag, s, addr, t0, t1;
+
+  for (auto &ip: itable) {
+
+    uint8_t n = add_instr(t, ip);
+    t.by_mnemonic[t.n_mnemonics++] = &ip;
+    
+    switch(ip.type) {
+      
+    case Instr::GB: // Generic type B
+    case Instr::SK: // Skip
+    case Instr::GA: // Generic type A
+    case Instr::IG: // IO instuction pretending to be Generic
+      t.index[ip.opcode] = n;
+      break;
+          
+    case Instr::SH: // Shift
+      for (addr=0; addr<64; addr++) {
+        i = (ip.opcode << 6) | (addr & 0x03f);
+        t.index[i] = n;
+      }
+      break;
+          
+    case Instr::MR: // Memory reference
+      for (ind=0; ind < 2; ind++) {
+        for (addr=0; addr<512; addr++) {
+          for (s=0; s<2; s++) {
+            if (ip.opcode & 0x20) { // STX/LDX
+              t0=t1=(ip.opcode >> 4) & 1;
+            } else {
+              t0=0; t1=1;
+            }
+            for (tag=t0; tag<=t1; tag++) {
+              i = ((ind & 1) << 15) |
+                ((tag & 1) << 14) |
+                ((ip.opcode & 0x0f) << 10) |
+                ((s & 1) << 9) |
+                (addr & 0777);
+              t.index[i] = n;
+            }
+          }
+        }
+      }
+      break;
+          
+    case Instr::IO: // IO intructions
+      for (addr=0; addr<1024; addr++) {
+        i = ((ip.opcode & 0x3f) << 10) | (addr & 0x3ff);
+        if ((ip.opcode & 077) == 074) { // OTA or SMK
+          if (((addr &0x3f) == 020) || ((addr &0x3f) == 024)) {
+            // device code is SMK
+            if (i != 0171020) { // OTK
+              if (ip.opcode & 0x40) {
+                // opcode is flagged as SMK too 
+                t.index[i] = n;
+              }
+            }
+          } else {
+            // device code is OTA
+            if (!(ip.opcode & 0x40)) {
+              t.index[i] = n;
+            }
+          }
+        } else {
+          t.index[i] = n;
+        }
+      }
+      break;
+
+    default:
+      throw "Bad instruction type";
+    } 
+  }
 }
 
+consteval InstrTable::Tables InstrTable::build_tables()
+{
+  Tables t{};
+
+  // Everything starts off unimplemented
+  (void) add_instr(t, uimp);
+  uint8_t n_gskp = add_instr(t, gskp);
+  uint8_t n_gshf = add_instr(t, gshf);
+  uint8_t n_gena = add_instr(t, gena);
+
+  build_one_instr_table(t, standard);
+  build_one_instr_table(t, ea);
+  build_one_instr_table(t, ml);
+  build_one_instr_table(t, mp);
+  build_one_instr_table(t, hsa);
+#if ((!defined(GENERIC_GROUP_A)) || defined(TEST_GENERIC_GROUP_A))
+  build_one_instr_table(t, NPL_group_a);
+
+  //
+  // Many Group A instructions have alternate opcodes that
+  // produce the same actions
+  //
+  for (auto &alias: aliases)
+    apply_one_alias(t, alias);
 #endif
+
+  //
+  // Now deal with the instructions that we have the ability
+  // to deal with as groups; so that "microcoding" of the
+  // machine works right. Acording to 
+  // "Micro-coding the DDP-516 computer, Donald A Bell
+  //  NPL Com. Sci. T.M. 54 April 1971"
+  //
+
+  // Skip...
+  for (unsigned i=0x8000; i<0x8400; i++)
+    if (t.index[i] == 0)
+      t.index[i] = n_gskp;
+
+  // Shift...
+  for (unsigned i=0x4000; i<0x4400; i++)
+    if (t.index[i] == 0)
+      t.index[i] = n_gshf;
+
+  // Generic group A...
+  for (unsigned i=0xc000; i<0xc400; i++)
+    if (t.index[i] == 0)
+      t.index[i] = n_gena;
+
+  //
+  // Sort the mnemonics for lookup(). This is an insertion
+  // sort so that, as with the std::map that this replaced,
+  // the last of any duplicate mnemonics is the one found.
+  //
+  for (unsigned i=1; i<t.n_mnemonics; i++) {
+    const Instr *ip = t.by_mnemonic[i];
+    unsigned j = i;
+    while ((j > 0) &&
+           (std::string_view(ip->mnemonic) <
+            std::string_view(t.by_mnemonic[j-1]->mnemonic))) {
+      t.by_mnemonic[j] = t.by_mnemonic[j-1];
+      j--;
+    }
+    t.by_mnemonic[j] = ip;
+  }
+
+  return t;
+}
+
+constexpr InstrTable::Tables InstrTable::tables = InstrTable::build_tables();
+
+InstrTable::InstrTable()
+{
+}
+
+const std::string InstrTable::disassemble(uint16_t addr,
+                                          uint16_t instr,
+                                          bool brk,
+                                          uint16_t y,
+                                          bool y_valid) const
+{
+  return tables.instrs[tables.index[instr]]->disassemble(addr, instr, brk, y, y_valid,
+                                                         tables.is_alias(instr));
+}
+
+const InstrTable::Instr *InstrTable::lookup(const std::string &mnemonic) const
+{
+  auto first = tables.by_mnemonic.begin();
+  auto last = first + tables.n_mnemonics;
+  auto it = std::upper_bound(first, last, mnemonic,
+                             [](const std::string &m, const Instr *ip) {
+                               return m < ip->mnemonic;
+                             });
+
+  if ((it == first) || (mnemonic != (*(it-1))->mnemonic)) {
+    return nullptr;
+  } else {
+    return *(it-1);
+  }
+}
+
+void InstrTable::dump_instructions() const
+{
+  for (unsigned i=0; i<65536; i++) {
+    const char *m = tables.instrs[tables.index[i]]->mnemonic;
+    if (tables.is_alias(i))
+      std::cout << std::format("{:0>6o} ({})\n", i, m);
+    else
+      std::cout << std::format("{:0>6o} {}\n", i, m);
+  }
+}
@@ -23,8 +23,8 @@
 
 #include <cstdint>
 #include <string>
-#include <vector>
-#include <map>
+#include <array>
+#include <span>
 
 /*
  * Turn the following on to use just the common code for
@@ -36,6 +36,7 @@
 //#define GENERIC_GROUP_A
 //#define TEST_GENERIC_GROUP_A
 //#define TEST_GENERIC_SKIP
+//#define TEST_MULTIPLY_DIVIDE
 
 namespace h16 {
   
@@ -59,23 +60,30 @@ namespace h16 {
         IG  // IO instuction pretending to be Generic
       };
     
-      std::string mnemonic;
+      const char *mnemonic;
       INSTR_TYPE  type;
       uint16_t    opcode;
-      std::string description;
+      const char *description;
       ExecFunc_pt exec;
 
-      Instr(const std::string &mnemonic,
-            INSTR_TYPE type,
-            uint16_t opcode,
-            const std::string &description,
-            ExecFunc_pt exec);
+      constexpr Instr(const char *mnemonic,
+                      INSTR_TYPE type,
+                      uint16_t opcode,
+                      const char *description,
+                      ExecFunc_pt exec)
+        : mnemonic(mnemonic),
+          type(type),
+          opcode(opcode),
+          description(description),
+          exec(exec) {
+      }
     
       const std::string disassemble(uint16_t addr,
                                     uint16_t instr,
                                     bool brk,
                                     uint16_t y = 0,
-                                    bool y_valid = false) const;
+                                    bool y_valid = false,
+                                    bool alias = false) const;
 
       static signed short ex_sc(uint16_t instr);
 
@@ -85,20 +93,24 @@ namespace h16 {
                                 bool y_valid = false);
     };
 
-    typedef std::vector<Instr> InstrTable_t;
-    typedef std::vector<uint16_t> AliasTable_t;
-
     InstrTable();
 
     //
     // dispatch returns a pointer to the appropriate function
     // to do the action of the instruction it is passed
     //
+    // The 64K-entry table only holds a one-byte index into the
+    // (small) table of distinct instructions, so that the whole
+    // thing is 64KiB rather than 1MiB of pointers-to-member.
+    //
     inline ExecFunc_pt dispatch(uint16_t instr)
-    { return dispatch_table[instr]; }
+    { return tables.exec[tables.index[instr]]; }
     
     inline bool defined(uint16_t instr)
-    { return instructions[instr].type != Instr::UD; }
+    { return tables.instrs[tables.index[instr]]->type != Instr::UD; }
+
+    inline Instr::INSTR_TYPE type(uint16_t instr) const
+    { return tables.instrs[tables.index[instr]]->type; }
 
     const std::string disassemble(uint16_t addr,
                                   uint16_t instr,
@@ -111,78 +123,54 @@ namespace h16 {
   
   private:
     static const uint16_t B7 = 0001000; // Big-endian bit 7
-    
-    InstrTable_t instructions;
-    std::vector<ExecFunc_pt> dispatch_table;
-    std::map<std::string, const Instr *> mnemonic_to_instr;
-
-    static const InstrTable_t standard;
-    static const InstrTable_t ea;
-    static const InstrTable_t ml;
-    static const InstrTable_t mp;
-    static const InstrTable_t hsa;
+
+    //
+    // The decode tables are computed at compile time (by
+    // build_tables()) from the instruction and alias tables
+    // below, so they are read-only data and cost nothing at
+    // startup.
+    //
+    static const unsigned MAX_INSTRS = 256;
+
+    struct Tables {
+      // The distinct instructions; index 0 is uimp
+      std::array<const Instr *, MAX_INSTRS> instrs;
+      std::array<ExecFunc_pt, MAX_INSTRS> exec;
+      unsigned n_instrs;
+
+      // Opcode to instrs[] index
+      std::array<uint8_t, (1<<16)> index;
+
+      // One bit per opcode, set if it is an alternative opcode
+      std::array<uint64_t, (1<<16)/64> alias;
+
+      // instrs[] sorted by mnemonic, for lookup()
+      std::array<const Instr *, MAX_INSTRS> by_mnemonic;
+      unsigned n_mnemonics;
+
+      constexpr bool is_alias(uint16_t instr) const
+      { return (alias[instr >> 6] >> (instr & 63)) & 1; }
+    };
+
+    static const Tables tables;
+    static consteval Tables build_tables();
+    static consteval uint8_t add_instr(Tables &t, const Instr &ip);
+    static consteval void build_one_instr_table(Tables &t,
+                                                std::span<const Instr> itable);
 #if ((!defined(GENERIC_GROUP_A)) || defined(TEST_GENERIC_GROUP_A))
-    static const InstrTable_t NPL_group_a;
+    static consteval void apply_one_alias(Tables &t,
+                                          std::span<const uint16_t> alias);
 #endif
-    static const std::vector<InstrTable_t> instr_tables;
 
+    static const Instr standard[];
+    static const Instr ea[];
+    static const Instr ml[];
+    static const Instr mp[];
+    static const Instr hsa[];
 #if ((!defined(GENERIC_GROUP_A)) || defined(TEST_GENERIC_GROUP_A))
-    static const AliasTable_t HLT_alias;
-    static const AliasTable_t CMA_alias;
-    static const AliasTable_t CRA_alias;
-    static const AliasTable_t SSM_alias;
-    static const AliasTable_t CHS_alias;
-    static const AliasTable_t CAR_alias;
-    static const AliasTable_t CAL_alias;
-    static const AliasTable_t SSP_alias;
-    static const AliasTable_t ICL_alias;
-    static const AliasTable_t ICR_alias;
-    static const AliasTable_t RCB_alias;
-    static const AliasTable_t CSA_alias;
-    static const AliasTable_t TCA_alias;
-    static const AliasTable_t ICA_alias;
-    static const AliasTable_t SCB_alias;
-    static const AliasTable_t AOA_alias;
-    static const AliasTable_t AD1_alias;
-    static const AliasTable_t AD1_15_alias;
-    static const AliasTable_t ACA_alias;
-    static const AliasTable_t ADC_alias;
-    static const AliasTable_t ADC_15_alias;
-    static const AliasTable_t CM1_alias;
-    static const AliasTable_t LTR_alias;
-    static const AliasTable_t BTR_alias;
-    static const AliasTable_t BTL_alias;
-    static const AliasTable_t RTL_alias;
-    static const AliasTable_t RCB_SSP_alias;
-    static const AliasTable_t CPY_alias;
-    static const AliasTable_t BTB_alias;
-    static const AliasTable_t BCL_alias;
-    static const AliasTable_t BCR_alias;
-    static const AliasTable_t LD1_alias;
-    static const AliasTable_t ISG_alias;
-    static const AliasTable_t CMA_ACA_alias;
-    static const AliasTable_t CMA_ACA_C_alias;
-    static const AliasTable_t A2A_alias;
-    static const AliasTable_t A2C_alias;
-    static const AliasTable_t ICS_alias;
-    static const AliasTable_t SCB_A2A_alias;
-    static const AliasTable_t SCB_AOA_alias;
-    static const AliasTable_t A2C_SCB_alias;
-    static const AliasTable_t ACA_SCB_alias;
-    static const AliasTable_t ICR_SCB_alias;
-    static const AliasTable_t RTL_SCB_alias;
-    static const AliasTable_t BTB_SCB_alias;
-    static const AliasTable_t NOA_alias;
-
-    static const std::vector<AliasTable_t> aliases;
-  
-    void apply_one_alias(const AliasTable_t &alias);
-    void apply_aliases();
+    static const Instr NPL_group_a[];
 #endif
 
-    void build_one_instr_table(const InstrTable_t &itable);
-    void build_instr_tables();
-  
     // Common instructions
     static const Instr uimp; // Unimplemented instruction
     static const Instr gskp; // Generic skip
@@ -26,6 +26,8 @@
 #include <cassert>
 #include <string>
 #include <set>
+#include <iostream>
+#include <format>
 
 #include "dum.hpp"
 #include "nul.hpp"
@@ -45,6 +47,7 @@
 #endif
 
 #include "proc.hpp"
+#include "snapshot.hpp"
 
 #define D(X) static_cast<unsigned>(Device::X)
 
@@ -100,6 +103,13 @@ IoDispatch::IoDispatch(IoToPIntf &p)
   for( ; i<16; i++) {
     dmc_table.push_back(dum);
   }
+
+  for (unsigned i=0; i<io_table.size(); i++) {
+    if (device_id(io_table[i]) == static_cast<int>(i))
+      io_table[i]->set_id(i);
+  }
+
+  clear_io_counts();
 }
 
 IoDispatch::~IoDispatch() {
@@ -120,22 +130,27 @@ void IoDispatch::master_clear_devices()
 }
 
 IoStatus IoDispatch::ina(uint16_t instr, int16_t &data) {
+  io_counts[device_addr(instr)][IO_INA]++;
   return io_table[device_addr(instr)] -> ina(instr, data);
 }
 
 IoStatus IoDispatch::sks(uint16_t instr) {
+  io_counts[device_addr(instr)][IO_SKS]++;
   return io_table[device_addr(instr)] -> sks(instr);
 }
 
 IoStatus IoDispatch::ota(uint16_t instr, int16_t data) {
+  io_counts[device_addr(instr)][IO_OTA]++;
   return io_table[device_addr(instr)] -> ota(instr, data);
 }
 
 void IoDispatch::ocp(uint16_t instr) {
+  io_counts[device_addr(instr)][IO_OCP]++;
   io_table[device_addr(instr)] -> ocp(instr);
 }
 
 void IoDispatch::smk(uint16_t mask) {
+  smk_count++;
   for (auto d: io_table) {
     d->smk(mask);
   }
@@ -154,6 +169,14 @@ void IoDispatch::set_filename(Device dev, const std::string &filename, int subde
   io_table[static_cast<unsigned>(dev)] -> set_filename(filename, subdevice);
 }
 
+bool IoDispatch::set_turbo(Device dev, bool on) {
+  return io_table[static_cast<unsigned>(dev)] -> set_turbo(on);
+}
+
+bool IoDispatch::get_turbo(Device dev) const {
+  return io_table[static_cast<unsigned>(dev)] -> get_turbo();
+}
+
 bool IoDispatch::tty_special(char k) {
   bool r = false;
   PToIoIntf *p = io_table[static_cast<unsigned>(Device::ASR)];
@@ -166,6 +189,98 @@ bool IoDispatch::tty_special(char k) {
   return r;
 }
 
+int IoDispatch::device_id(const PToIoIntf *d) const {
+  for (unsigned i=0; i<io_table.size(); i++) {
+    if (io_table[i] == d)
+      return i;
+  }
+  return -1;
+}
+
+PToIoIntf *IoDispatch::device(int id) const {
+  return ((id >= 0) && (static_cast<unsigned>(id) < io_table.size())) ?
+    io_table[id] : nullptr;
+}
+
+void IoDispatch::clear_io_counts() {
+  for (auto &c: io_counts) {
+    for (auto &k: c)
+      k = 0;
+  }
+  smk_count = 0;
+}
+
+std::string IoDispatch::device_name(const PToIoIntf *d) {
+  const IoDev *io = dynamic_cast<const IoDev *>(d);
+  return (io) ? io->name() : "";
+}
+
+void IoDispatch::save_devices(SnapshotWriter &w) const {
+  for (unsigned i=0; i<io_table.size(); i++) {
+    if (device_id(io_table[i]) == static_cast<int>(i)) {
+      w.begin("DEV ");
+      w.put8(i);
+      w.put_string(device_name(io_table[i]));
+      io_table[i]->save_state(w);
+      w.end();
+    }
+  }
+}
+
+/*
+ * A device that was saved but is not here now (a different
+ * build, say) is an error, as is one whose state is shorter than
+ * it writes now; one that is here but was not saved is left as
+ * it is.
+ */
+bool IoDispatch::check_devices(SnapshotReader &r) const {
+  bool ok = true;
+
+  while (r.next_is("DEV ")) {
+    r.begin("DEV ");
+    const int id = r.get8();
+    const std::string name = r.get_string();
+    PToIoIntf *d = device(id);
+
+    if (d && (device_id(d) == id) && (device_name(d) == name)) {
+      SnapshotWriter w;
+      const size_t before = w.size();
+      d->save_state(w);
+      if (r.left() < (w.size() - before)) {
+        std::cerr << std::format("Snapshot device {} at '{:0>2o} is short\n", name, id);
+        ok = false;
+      }
+    } else {
+      std::cerr << std::format("Snapshot device {} at '{:0>2o} is not here\n", name, id);
+      ok = false;
+    }
+    r.end();
+  }
+
+  return ok && r.ok();
+}
+
+bool IoDispatch::restore_devices(SnapshotReader &r) {
+  bool ok = true;
+
+  while (r.next_is("DEV ")) {
+    r.begin("DEV ");
+    const int id = r.get8();
+    const std::string name = r.get_string();
+    PToIoIntf *d = device(id);
+
+    if (d && (device_id(d) == id) && (device_name(d) == name)) {
+      d->restore_state(r);
+    } else {
+      std::cerr << std::format("Snapshot device {} at '{:0>2o} is not here\n", name, id);
+      ok = false;
+    }
+    r.end();
+  }
+
+  return ok && r.ok();
+}
+
 const char *IoDispatch::name() const {
   return "Dispatch";
 }
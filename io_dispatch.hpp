@@ -67,11 +67,39 @@ namespace h16 {
     void event(Device dev, unsigned reason);
 
     void set_filename(Device dev, const std::string &filename, int subdevice = 0);
+    bool set_turbo(Device dev, bool on);
+    bool get_turbo(Device dev) const;
     bool tty_special(char k);
 
+    /*
+     * Snapshots. Devices are known by the (lowest) address they
+     * are at.
+     */
+    void save_devices(SnapshotWriter &w) const;
+    bool check_devices(SnapshotReader &r) const;
+    bool restore_devices(SnapshotReader &r);
+    int device_id(const PToIoIntf *d) const;
+    PToIoIntf *device(int id) const;
+    static std::string device_name(const PToIoIntf *d);
+
+    /*
+     * Statistics: I/O instructions to each device address, by
+     * kind, and SMKs (which go to them all)
+     */
+    enum IoKind {
+      IO_OCP, IO_SKS, IO_INA, IO_OTA, IO_KINDS
+    };
+    uint64_t get_io_count(unsigned addr, IoKind k) const {
+      return io_counts[addr][k];
+    }
+    uint64_t get_smk_count() const { return smk_count; }
+    void clear_io_counts();
+
   private:
     std::vector<PToIoIntf *> io_table;
     std::vector<PToIoIntf *> dmc_table;
+    uint64_t io_counts[64][IO_KINDS];
+    uint64_t smk_count;
     const char *name() const;
   };
 }
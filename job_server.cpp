@@ -0,0 +1,331 @@
+/* Honeywell Series 16 emulator
+ *
+ * Copyright (C) 2026  Adrian Wise
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA  02111-1307 USA
+ */
+
+#include "job_server.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <csignal>
+#include <iostream>
+#include <format>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+// Longest request (two paths and their newlines)
+#define MAX_REQUEST (2 * (PATH_MAX + 1))
+
+using namespace h16;
+
+static volatile sig_atomic_t stop_serving = 0;
+
+static void stop_handler(int signo)
+{
+  stop_serving = 1;
+}
+
+static bool socket_address(const std::string &name, struct sockaddr_un &addr)
+{
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+
+  if (name.size() >= sizeof(addr.sun_path)) {
+    std::cerr << std::format("Socket name <{}> is too long\n", name);
+    return false;
+  }
+
+  strcpy(addr.sun_path, name.c_str());
+  return true;
+}
+
+static bool write_all(int fd, const char *buf, size_t n)
+{
+  while (n > 0) {
+    ssize_t r = write(fd, buf, n);
+    if (r < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    buf += r;
+    n -= r;
+  }
+  return true;
+}
+
+static std::string current_directory()
+{
+  char buf[PATH_MAX];
+  return (getcwd(buf, sizeof(buf))) ? std::string(buf) : std::string(".");
+}
+
+JobServer::JobServer()
+  : listen_fd(-1)
+{
+}
+
+JobServer::~JobServer()
+{
+  if (listen_fd >= 0) {
+    close(listen_fd);
+    unlink(socket_name.c_str());
+  }
+}
+
+bool JobServer::open(const std::string &socket_name)
+{
+  struct sockaddr_un addr;
+  struct stat st;
+
+  if (!socket_address(socket_name, addr))
+    return false;
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    std::cerr << std::format("Could not create socket: {}\n", strerror(errno));
+    return false;
+  }
+
+  /*
+   * A socket left behind by a server that has gone away is
+   * removed, but one that still answers is not stolen
+   */
+  if ((stat(socket_name.c_str(), &st) == 0) && S_ISSOCK(st.st_mode)) {
+    if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == 0) {
+      std::cerr << std::format("A server is already using <{}>\n", socket_name);
+      close(fd);
+      return false;
+    }
+    unlink(socket_name.c_str());
+  }
+
+  if ((bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0) ||
+      (listen(fd, SOMAXCONN) != 0)) {
+    std::cerr << std::format("Could not listen on <{}>: {}\n",
+                             socket_name, strerror(errno));
+    close(fd);
+    return false;
+  }
+
+  // A submitter that goes away must not take the server with it
+  signal(SIGPIPE, SIG_IGN);
+
+  // Finished jobs need no reaping
+  signal(SIGCHLD, SIG_IGN);
+
+  // ^C or kill stop the server (jobs already running carry on)
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = stop_handler;
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+
+  this->socket_name = socket_name;
+  listen_fd = fd;
+
+  return true;
+}
+
+bool JobServer::next_job(std::string &script)
+{
+  while ((listen_fd >= 0) && !stop_serving) {
+    int fd = accept(listen_fd, nullptr, nullptr);
+    if (fd < 0) {
+      if (errno == EINTR)
+        continue;
+      std::cerr << std::format("Could not accept a job: {}\n", strerror(errno));
+      return false;
+    }
+
+    std::cout.flush();
+    fflush(stdout);
+    fflush(stderr);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+      const std::string msg = std::format("Could not start job: {}\n", strerror(errno));
+      (void) write_all(fd, msg.data(), msg.size());
+      send_status(fd, 1);
+    } else if (pid == 0) {
+      close(listen_fd);
+      listen_fd = -1;
+      signal(SIGINT, SIG_DFL);
+      signal(SIGTERM, SIG_DFL);
+      signal(SIGPIPE, SIG_DFL);
+      signal(SIGCHLD, SIG_DFL);
+
+      return start_job(fd, script);
+    }
+
+    close(fd);
+  }
+
+  return false;
+}
+
+/*
+ * In the child: read the request, run the job in a grandchild and
+ * send its exit status. Returns true only in the grandchild.
+ */
+bool JobServer::start_job(int fd, std::string &script)
+{
+  std::string request;
+  char buf[256];
+  ssize_t n;
+  while (((n = read(fd, buf, sizeof(buf))) != 0) &&
+         (request.size() < MAX_REQUEST)) {
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    request.append(buf, n);
+  }
+
+  size_t nl1 = request.find('\n');
+  size_t nl2 = (nl1 == std::string::npos) ? nl1 : request.find('\n', nl1 + 1);
+  if (nl2 == std::string::npos) {
+    const std::string msg("Not a job request\n");
+    (void) write_all(fd, msg.data(), msg.size());
+    send_status(fd, 1);
+    _exit(0);
+  }
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    // The job
+    dup2(fd, STDIN_FILENO);
+    dup2(fd, STDOUT_FILENO);
+    dup2(fd, STDERR_FILENO);
+    close(fd);
+
+    const std::string cwd = request.substr(0, nl1);
+    if (chdir(cwd.c_str()) != 0) {
+      std::cerr << std::format("Could not change directory to <{}>\n", cwd);
+      _exit(1);
+    }
+
+    script = request.substr(nl1 + 1, nl2 - nl1 - 1);
+    return true;
+  }
+
+  int status = 1;
+  if (pid < 0) {
+    const std::string msg = std::format("Could not start job: {}\n", strerror(errno));
+    (void) write_all(fd, msg.data(), msg.size());
+  } else {
+    int wstatus;
+    while (waitpid(pid, &wstatus, 0) < 0) {
+      if (errno != EINTR) {
+        wstatus = -1;
+        break;
+      }
+    }
+    if (wstatus == -1)
+      status = 1;
+    else if (WIFEXITED(wstatus))
+      status = WEXITSTATUS(wstatus);
+    else if (WIFSIGNALED(wstatus))
+      status = 128 + WTERMSIG(wstatus);
+  }
+
+  send_status(fd, status);
+  _exit(0);
+}
+
+const char JobServer::TRAILER[3] = {'\0', 'S', 'T'};
+
+void JobServer::send_status(int fd, int status)
+{
+  char trailer[TRAILER_SIZE];
+
+  memcpy(trailer, TRAILER, sizeof(TRAILER));
+  trailer[sizeof(TRAILER)] = static_cast<char>(status & 0xff);
+  (void) write_all(fd, trailer, sizeof(trailer));
+}
+
+int JobServer::submit(const std::string &socket_name,
+                      const std::string &script)
+{
+  struct sockaddr_un addr;
+
+  if (access(script.c_str(), R_OK) != 0) {
+    std::cerr << std::format("Could not open <{}> for reading\n", script);
+    return 1;
+  }
+
+  if (!socket_address(socket_name, addr))
+    return 1;
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if ((fd < 0) ||
+      (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0)) {
+    std::cerr << std::format("Could not connect to <{}>: {}\n",
+                             socket_name, strerror(errno));
+    if (fd >= 0)
+      close(fd);
+    return 1;
+  }
+
+  const std::string request = std::format("{}\n{}\n", current_directory(), script);
+  if (!write_all(fd, request.data(), request.size())) {
+    std::cerr << std::format("Could not send job to <{}>\n", socket_name);
+    close(fd);
+    return 1;
+  }
+  shutdown(fd, SHUT_WR);
+
+  /*
+   * The job's output, until the server closes the connection,
+   * always holding back what might be the trailer
+   */
+  std::string held;
+  char buf[4096];
+  ssize_t n;
+  while ((n = read(fd, buf, sizeof(buf))) != 0) {
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    held.append(buf, n);
+    if (held.size() > TRAILER_SIZE) {
+      const size_t out = held.size() - TRAILER_SIZE;
+      if (!write_all(STDOUT_FILENO, held.data(), out))
+        break;
+      held.erase(0, out);
+    }
+  }
+
+  close(fd);
+
+  if ((held.size() == TRAILER_SIZE) &&
+      (memcmp(held.data(), TRAILER, sizeof(TRAILER)) == 0))
+    return static_cast<unsigned char>(held[sizeof(TRAILER)]);
+
+  (void) write_all(STDOUT_FILENO, held.data(), held.size());
+  std::cerr << std::format("Job on <{}> ended without an exit status\n", socket_name);
+  return 1;
+}
@@ -0,0 +1,83 @@
+/* Honeywell Series 16 emulator
+ *
+ * Copyright (C) 2026  Adrian Wise
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA  02111-1307 USA
+ *
+ * Job server
+ *
+ * A resident h16 (started with -J) loads a program once, then runs
+ * monitor scripts submitted by other h16 processes (started with
+ * -j) over a Unix domain socket. A request is two lines,
+ *
+ *   the submitter's working directory
+ *   the script filename
+ *
+ * after which the submitter shuts down its side of the socket.
+ *
+ * Each job runs in a child process forked from the server, so it
+ * starts from the machine exactly as the server loaded it, however
+ * the job leaves it, and jobs can run side by side. The child reads
+ * the request, so a submitter that never finishes one holds up only
+ * its own job. It then forks again: the grandchild runs the script
+ * in the submitter's directory with the socket as its standard
+ * input, output and error, and the child waits for it and ends the
+ * output with a trailer,
+ *
+ *   a zero byte, "ST" and the job's exit status (one byte)
+ *
+ * which is 128 plus the signal number if the job was killed. The
+ * submitter exits with that status, or 1 if the output stops
+ * without a trailer. Files the script names are read and written
+ * by the job, so the server and submitter must see the same
+ * filesystem.
+ */
+
+#ifndef _JOB_SERVER_HPP_
+#define _JOB_SERVER_HPP_
+
+#include <string>
+
+namespace h16 {
+
+  class JobServer {
+  public:
+    JobServer();
+    ~JobServer();
+
+    bool open(const std::string &socket_name);
+
+    // Wait for the next job. Returns true in the grandchild that is
+    // to run it, false in the server when it is to stop.
+    bool next_job(std::string &script);
+
+    // Client side, returns the job's exit status
+    static int submit(const std::string &socket_name,
+                      const std::string &script);
+
+  private:
+    std::string socket_name;
+    int listen_fd;
+
+    bool start_job(int fd, std::string &script);
+
+    static const char TRAILER[3];
+    static const size_t TRAILER_SIZE = sizeof(TRAILER) + 1;
+    static void send_status(int fd, int status);
+  };
+}
+
+#endif // _JOB_SERVER_HPP_
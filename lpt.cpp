@@ -22,11 +22,13 @@
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
+#include <algorithm>
 
 #include "iodev.hpp"
 #include "stdtty.hpp"
 
 #include "proc.hpp"
+#include "snapshot.hpp"
 
 //#include <iostream>
 #include <sstream>
@@ -256,4 +258,30 @@ void LPT::set_filename(const std::string &filename, unsigned subdevice) {
 DEFINE_UNEXPECTED_INA(LPT)
 DEFINE_UNEXPECTED_DMC(LPT)
 
+/*
+ * Snapshots
+ */
+void LPT::save_state(SnapshotWriter &w) const
+{
+  w.put_bool(pending_nl);
+  w.put16(mask);
+  w.put32(scan_counter);
+  w.put_string(std::string(line, std::min(scan_counter, 120)));
+  w.put32(line_number);
+}
+
+void LPT::restore_state(SnapshotReader &r)
+{
+  if (fp) // The output file is not part of the snapshot
+    fclose(fp);
+  fp = NULL;
+  pending_nl = r.get_bool();
+  mask = r.get16();
+  scan_counter = r.get32();
+  std::string s = r.get_string();
+  memset(line, ' ', sizeof(line) - 1);
+  memcpy(line, s.data(), std::min(s.size(), sizeof(line) - 1));
+  line_number = r.get32();
+}
+
 DEFINE_STD_NAME(LPT)
@@ -65,9 +65,13 @@ const std::vector<Monitor::CmdTab> Monitor::commands {
   {"stop",       CmdTab::ANY, 0, 0, "Stop",                                         &Monitor::cont},
   {"limit",      CmdTab::ANY, 1, 1, "half_cycles : Set limit on simulated time",    &Monitor::limit},
   {"sbi",        CmdTab::ANY, 1, 1, "half_cycles : Schedule startbutton interrupt", &Monitor::sbi},
+  {"break",      CmdTab::ANY, 0, 64, "[addr/off] [,off] [when cond] : Get/Set/Clear breakpoints", &Monitor::brk},
+  {"watch",      CmdTab::ANY, 0, 64, "[addr/off] [,r/w/rw/off] [when cond] : Get/Set/Clear memory watchpoints", &Monitor::watch},
+  {"iowatch",    CmdTab::ANY, 0, 64, "[dev/off] [,off] [when cond] : Get/Set/Clear I/O watchpoints", &Monitor::iowatch},
   {"go",         CmdTab::HLT, 0, 1, "[addr] Start execution",                       &Monitor::go},
   {"ss",         CmdTab::ANY, 1, 2, "num [0/1] Get/Set Sense Switch",               &Monitor::ss},
   {"ptr",        CmdTab::ANY, 1, 1, "filename : Set Papertape Reader filename",     &Monitor::ptr},
+  {"ptr_turbo",  CmdTab::ANY, 0, 1, "[on/off] : Get/Set Papertape Reader turbo mode", &Monitor::ptr_turbo},
   {"ptp",        CmdTab::ANY, 1, 1, "filename : Set Papertape Punch filename",      &Monitor::ptp},
   {"plt",        CmdTab::ANY, 1, 1, "filename : Set Plotter filename",              &Monitor::plt},
   {"lpt",        CmdTab::ANY, 1, 1, "filename : Set Lineprinter filename",          &Monitor::lpt},
@@ -78,6 +82,21 @@ const std::vector<Monitor::CmdTab> Monitor::commands {
   {"clear",      CmdTab::ANY, 0, 0, "Master clear",                                 &Monitor::clear},
   {"help",       CmdTab::ANY, 0, 0, "Print this help",                              &Monitor::help},
   {"trace",      CmdTab::ANY, 0, 2, "[filename] [,lines] : Save trace file",        &Monitor::trace},
+  {"tmode",      CmdTab::ANY, 0, 2, "[off/pc/full] [,entries] : Get/Set trace mode", &Monitor::tmode},
+  {"tfile",      CmdTab::ANY, 0, 1, "[filename] : Start/Stop streaming trace file",  &Monitor::tfile},
+  {"engine",     CmdTab::ANY, 0, 1, "[interp/block] : Get/Set execution engine",    &Monitor::engine},
+  {"profile",    CmdTab::ANY, 0, 1, "[on/off/clear] : Get/Set execution profiling",  &Monitor::profile},
+  {"hotspots",   CmdTab::ANY, 0, 2, "[filename] [,lines] : Profile report (and save)", &Monitor::hotspots},
+  {"calls",      CmdTab::ANY, 0, 1, "[on/off/clear] : Get/Set call graph tracing", &Monitor::calls},
+  {"callgraph",  CmdTab::ANY, 0, 2, "[filename] [,lines] : Call graph report (save folded stacks)", &Monitor::callgraph},
+  {"stats",      CmdTab::ANY, 0, 1, "[clear] : Performance counters",               &Monitor::stats},
+  {"statslog",   CmdTab::ANY, 0, 2, "[off/filename] [,seconds] : Log counters as JSON lines", &Monitor::statslog},
+  {"changed",    CmdTab::ANY, 0, 1, "[generation] : Sectors written since generation", &Monitor::changed},
+  {"pace",       CmdTab::ANY, 0, 1, "[off/rate] : Get/Set real-time pacing (rate x real speed)", &Monitor::pace},
+  {"idle",       CmdTab::ANY, 0, 1, "[length] : Get/Set longest idle loop skipped (0 = off)", &Monitor::idle},
+  {"save",       CmdTab::ANY, 1, 1, "filename : Save machine snapshot",             &Monitor::save},
+  {"restore",    CmdTab::ANY, 1, 1, "filename : Restore machine snapshot",          &Monitor::restore},
+  {"load",       CmdTab::HLT, 1, 1, "filename : Load self-loading system tape",     &Monitor::load},
   {"disassemble",CmdTab::ANY, 1, 3, "[filename] first [,last] : Save disassembly",  &Monitor::disassemble},
   {"vmem",       CmdTab::ANY, 1, 2, "filename [, exec-addr] : Save Verilog Mem.",   &Monitor::vmem},
   {"omem",       CmdTab::ANY, 1, 2, "filename [, exec-addr] : Save Octal Mem.",     &Monitor::omem},
@@ -108,6 +127,7 @@ Monitor::Monitor(Proc &p, int argc, char **argv)
   , first_time(true)
   , doing_commands(false)
   , run(false)
+  , batch(false)
 {
   if (!monitor) {
     struct sigaction sa;
@@ -165,7 +185,9 @@ void Monitor::get_line(std::string &buffer, const std::string prompt, std::ifstr
     }
   }
   
-  if (!is) {
+  if (batch && !is) {
+    buffer = "quit";
+  } else if (!is) {
     stdTty.get_input(prompt, buffer, true);
   }
 }
@@ -434,6 +456,153 @@ bool Monitor::sbi(const std::vector<std::string> &args) {
   return ok;
 }
 
+/*
+ * break, watch and iowatch. With no arguments list what is set,
+ * "off" on its own clears them all. A point can be given a
+ * condition after "when" (see CPU::Condition).
+ */
+static bool when(std::vector<std::string> &args, bool &conditional,
+                 Proc::Condition &cond) {
+  auto w = std::find(args.begin(), args.end(), "when");
+
+  conditional = (w != args.end());
+  if (!conditional)
+    return true;
+
+  std::string text;
+  for (auto i = w + 1; i != args.end(); i++)
+    text += ((text.empty()) ? "" : " ") + *i;
+  args.erase(w, args.end());
+
+  if (!Proc::parse_condition(text, cond)) {
+    std::cerr << std::format("Bad condition <{}>\n", text);
+    return false;
+  }
+  return true;
+}
+
+std::string Monitor::condition_text(uint16_t addr, uint8_t kind) {
+  uint64_t hits;
+  const Proc::Condition *cond = p.get_condition(addr, kind, hits);
+
+  return (cond) ? std::format(" [when {}, hits {:d}]", cond->text, hits) : "";
+}
+
+bool Monitor::brk(const std::vector<std::string> &all_args) {
+  bool ok = true;
+  bool conditional;
+  Proc::Condition cond;
+  std::vector<std::string> args(all_args);
+
+  if (all_args.empty()) {
+    std::cout << "Breakpoints:";
+    for (unsigned addr = 0; addr < (p.get_sectors() << Proc::SECTOR_SHIFT); addr++) {
+      if (p.get_watch(addr) & Proc::WATCH_EXEC)
+        std::cout << std::format(" '{:0>6o}{}", addr, condition_text(addr, Proc::WATCH_EXEC));
+    }
+    std::cout << '\n';
+  } else if ((args.size() == 1) && (args.front() == "off")) {
+    p.clear_watches(Proc::WATCH_EXEC);
+  } else if (when(args, conditional, cond) && (args.size() > 0) && (args.size() <= 2)) {
+    uint16_t addr = parse_number(args.front(), ok);
+    bool on = (args.size() == 1);
+    ok = ok && (on || ((args[1] == "off") && !conditional));
+    if (ok && conditional) {
+      p.set_condition(addr, Proc::WATCH_EXEC, cond);
+    } else if (ok) {
+      p.set_watch(addr, Proc::WATCH_EXEC, on);
+    }
+  } else {
+    ok = false;
+  }
+
+  return ok;
+}
+
+bool Monitor::watch(const std::vector<std::string> &all_args) {
+  bool ok = true;
+  bool conditional;
+  Proc::Condition cond;
+  std::vector<std::string> args(all_args);
+  const uint8_t rw = Proc::WATCH_READ | Proc::WATCH_WRITE;
+
+  if (args.empty()) {
+    std::cout << "Watchpoints:";
+    for (unsigned addr = 0; addr < (p.get_sectors() << Proc::SECTOR_SHIFT); addr++) {
+      uint8_t w = p.get_watch(addr);
+      if (w & rw) {
+        std::cout << std::format(" '{:0>6o} {}{}{}{}", addr,
+                                 (w & Proc::WATCH_READ) ? "r" : "",
+                                 condition_text(addr, Proc::WATCH_READ),
+                                 (w & Proc::WATCH_WRITE) ? "w" : "",
+                                 condition_text(addr, Proc::WATCH_WRITE));
+      }
+    }
+    std::cout << '\n';
+  } else if ((args.size() == 1) && (args.front() == "off")) {
+    p.clear_watches(rw);
+  } else if (when(args, conditional, cond) && (args.size() > 0) && (args.size() <= 2)) {
+    uint16_t addr = parse_number(args.front(), ok);
+    uint8_t kinds = rw;
+    const std::string how = (args.size() > 1) ? args[1] : "rw";
+
+    if (how == "r") {
+      kinds = Proc::WATCH_READ;
+    } else if (how == "w") {
+      kinds = Proc::WATCH_WRITE;
+    } else if ((how != "rw") && ((how != "off") || conditional)) {
+      ok = false;
+    }
+
+    if (ok) {
+      p.set_watch(addr, rw, false);
+      for (uint8_t k: {Proc::WATCH_READ, Proc::WATCH_WRITE}) {
+        if ((how != "off") && (kinds & k)) {
+          if (conditional)
+            p.set_condition(addr, k, cond);
+          else
+            p.set_watch(addr, k, true);
+        }
+      }
+    }
+  } else {
+    ok = false;
+  }
+
+  return ok;
+}
+
+bool Monitor::iowatch(const std::vector<std::string> &all_args) {
+  bool ok = true;
+  bool conditional;
+  Proc::Condition cond;
+  std::vector<std::string> args(all_args);
+
+  if (args.empty()) {
+    std::cout << "I/O watchpoints:";
+    for (unsigned dev = 0; dev < 0100; dev++) {
+      if (p.get_io_watch(dev))
+        std::cout << std::format(" '{:0>2o}{}", dev, condition_text(dev, Proc::WATCH_IO));
+    }
+    std::cout << '\n';
+  } else if ((args.size() == 1) && (args.front() == "off")) {
+    p.clear_watches(Proc::WATCH_IO);
+  } else if (when(args, conditional, cond) && (args.size() > 0) && (args.size() <= 2)) {
+    long dev = parse_number(args.front(), ok);
+    bool on = (args.size() == 1);
+    ok = ok && (dev >= 0) && (dev < 0100) && (on || ((args[1] == "off") && !conditional));
+    if (ok && conditional) {
+      p.set_condition(dev, Proc::WATCH_IO, cond);
+    } else if (ok) {
+      p.set_io_watch(dev, on);
+    }
+  } else {
+    ok = false;
+  }
+
+  return ok;
+}
+
 bool Monitor::ss(const std::vector<std::string> &args) {
   bool ok = true;
   int sw;
@@ -491,6 +660,22 @@ ASR_FNAME(asr_ptp,PTP)
 ASR_FNAME_EV(asr_ptr_on,PTR,PTR_ON)
 ASR_FNAME_EV(asr_ptp_on,PTP,PTP_ON)
 
+#define TURBO(fn,DEV)                                                   \
+  bool Monitor::fn(const std::vector<std::string> &args) {              \
+    bool ok = true;                                                     \
+    if (args.size() > 0) {                                              \
+      bool on = (args.front() == "on");                                 \
+      ok = (on || (args.front() == "off")) &&                           \
+        p.set_turbo(IoDispatch::Device::DEV, on);                       \
+    } else {                                                            \
+      std::cout << std::format("Turbo: {}\n",                           \
+        p.get_turbo(IoDispatch::Device::DEV) ? "on" : "off");           \
+    }                                                                   \
+    return ok;                                                          \
+  }
+
+TURBO(ptr_turbo,PTR)
+
 
 bool Monitor::a(const std::vector<std::string> &args) {
   return reg(args, REG::A);
@@ -553,10 +738,10 @@ bool Monitor::m(const std::vector<std::string> &args) {
   if (args.size() > 1) {
     val = parse_number(args[1], ok);
     if (ok) {
-      p.write(addr, val);
+      p.poke(addr, val);
     }
   } else {
-    val = p.read(addr);
+    val = p.peek(addr);
     std::cout << std::format("0x{:0>4x} \'{:0>6o} : 0x{:0>4x} \'{:0>6o} {}\n",
                              addr, addr, val, val, binary16(val));
   }
@@ -626,6 +811,276 @@ bool Monitor::trace(const std::vector<std::string> &args) {
   return ok;
 }
 
+bool Monitor::tmode(const std::vector<std::string> &args) {
+  bool ok = true;
+  Proc::TraceMode mode = p.get_trace_mode();
+  unsigned entries = p.get_trace_entries();
+
+  if (args.size() > 0) {
+    ok = Proc::parse_trace_mode(args.front(), mode);
+
+    if (ok && (args.size() > 1)) {
+      long n = parse_number(args[1], ok);
+      if ((n <= 0) || (n > Proc::MAX_TRACE_ENTRIES))
+        ok = false;
+      entries = n;
+    }
+
+    if (ok) {
+      p.set_trace(mode, entries);
+    }
+  } else {
+    std::cout << std::format("Trace: {} {:d}\n",
+                             Proc::trace_mode_name(mode), entries);
+  }
+
+  return ok;
+}
+
+bool Monitor::tfile(const std::vector<std::string> &args) {
+  bool ok;
+
+  if (args.size() > 0) {
+    ok = p.set_trace_file(args.front());
+  } else {
+    ok = p.close_trace_file();
+  }
+
+  return ok;
+}
+
+bool Monitor::engine(const std::vector<std::string> &args) {
+  bool ok = true;
+  Proc::Engine e = p.get_engine();
+
+  if (args.size() > 0) {
+    ok = Proc::parse_engine(args.front(), e);
+    if (ok) {
+      p.set_engine(e);
+    }
+  } else {
+    std::cout << std::format("Engine: {}\n", Proc::engine_name(e));
+  }
+
+  return ok;
+}
+
+bool Monitor::profile(const std::vector<std::string> &args) {
+  bool ok = true;
+
+  if (args.size() > 0) {
+    if (args.front() == "on") {
+      p.set_profile(true);
+    } else if (args.front() == "off") {
+      p.set_profile(false);
+    } else if (args.front() == "clear") {
+      p.clear_profile();
+    } else {
+      ok = false;
+    }
+  } else {
+    std::cout << std::format("Profile: {}\n", (p.get_profile()) ? "on" : "off");
+  }
+
+  return ok;
+}
+
+bool Monitor::hotspots(const std::vector<std::string> &args) {
+  bool ok = true;
+  std::string filename;
+  int lines = 0;
+
+  /*
+   * As for trace, if args[0] is a number then it's the number
+   * of lines rather than a filename.
+   */
+  if (args.size() > 0) {
+    lines = parse_number(args.front(), ok);
+    if (!ok) {
+      filename = args.front();
+      ok = true;
+      lines = 0;
+    }
+  }
+
+  if (args.size() > 1) {
+    lines = parse_number(args[1], ok);
+  }
+
+  if (ok && (lines >= 0)) {
+    ok = p.dump_profile(filename, lines);
+  } else {
+    ok = false;
+  }
+
+  return ok;
+}
+
+bool Monitor::calls(const std::vector<std::string> &args) {
+  bool ok = true;
+
+  if (args.size() > 0) {
+    if (args.front() == "on") {
+      p.set_callgraph(true);
+    } else if (args.front() == "off") {
+      p.set_callgraph(false);
+    } else if (args.front() == "clear") {
+      p.clear_callgraph();
+    } else {
+      ok = false;
+    }
+  } else {
+    std::cout << std::format("Call graph: {}\n", (p.get_callgraph()) ? "on" : "off");
+  }
+
+  return ok;
+}
+
+bool Monitor::callgraph(const std::vector<std::string> &args) {
+  bool ok = true;
+  std::string filename;
+  int lines = 0;
+
+  /*
+   * As for hotspots
+   */
+  if (args.size() > 0) {
+    lines = parse_number(args.front(), ok);
+    if (!ok) {
+      filename = args.front();
+      ok = true;
+      lines = 0;
+    }
+  }
+
+  if (args.size() > 1) {
+    lines = parse_number(args[1], ok);
+  }
+
+  if (ok && (lines >= 0)) {
+    ok = p.dump_callgraph(filename, lines);
+  } else {
+    ok = false;
+  }
+
+  return ok;
+}
+
+bool Monitor::stats(const std::vector<std::string> &args) {
+  bool ok = true;
+
+  if (args.size() > 0) {
+    if (args.front() == "clear") {
+      p.clear_stats();
+    } else {
+      ok = false;
+    }
+  } else {
+    p.print_stats();
+  }
+
+  return ok;
+}
+
+bool Monitor::statslog(const std::vector<std::string> &args) {
+  bool ok = true;
+
+  if (args.size() > 0) {
+    if (args.front() == "off") {
+      p.close_stats_log();
+    } else {
+      double seconds = 1.0;
+      if (args.size() > 1) {
+        char *end;
+        seconds = strtod(args[1].c_str(), &end);
+        ok = (*end == '\0') && (end != args[1].c_str());
+      }
+      if (ok) {
+        ok = p.set_stats_log(args.front(), seconds);
+      }
+    }
+  } else {
+    std::cout << std::format("Stats log: {}\n", (p.get_stats_log()) ? "on" : "off");
+  }
+
+  return ok;
+}
+
+bool Monitor::pace(const std::vector<std::string> &args) {
+  bool ok = true;
+
+  if (args.size() > 0) {
+    double rate = 0.0;
+    ok = Proc::parse_pace(args.front(), rate);
+    if (ok) {
+      p.set_pace(rate);
+    }
+  } else if (p.get_pace() == 0.0) {
+    std::cout << "Pace: off\n";
+  } else {
+    const Proc::PaceStats &s = p.get_pace_stats();
+    std::cout << std::format("Pace: {:g}x real time\n", p.get_pace());
+    std::cout << std::format("Drift: {:.6f}s (max ahead {:.6f}s, max behind {:.6f}s)\n",
+                             s.drift, s.max_ahead, s.max_behind);
+    std::cout << std::format("Slept: {:.3f}s in {:d} sleeps, {:d} resyncs\n",
+                             s.slept, s.sleeps, s.resyncs);
+  }
+
+  return ok;
+}
+
+bool Monitor::idle(const std::vector<std::string> &args) {
+  bool ok = true;
+
+  if (args.size() > 0) {
+    long n = parse_number(args.front(), ok);
+    if (ok && (n >= 0)) {
+      p.set_idle_length(n);
+    } else {
+      ok = false;
+    }
+  } else {
+    std::cout << std::format("Idle length: {:d}, half-cycles skipped: {:d}\n",
+                             p.get_idle_length(), p.get_idle_skipped());
+  }
+
+  return ok;
+}
+
+bool Monitor::save(const std::vector<std::string> &args) {
+  return p.save_snapshot(args.front());
+}
+
+bool Monitor::restore(const std::vector<std::string> &args) {
+  return p.restore_snapshot(args.front());
+}
+
+bool Monitor::load(const std::vector<std::string> &args) {
+  return p.load_system_tape(args.front());
+}
+
+bool Monitor::changed(const std::vector<std::string> &args) {
+  bool ok = true;
+  uint64_t generation = p.get_write_generation();
+
+  std::cout << std::format("Generation: {:d}\n", generation);
+
+  if (args.size() > 0) {
+    generation = parse_ull(args.front(), ok);
+
+    for (unsigned s=0; ok && (s<p.get_sectors()); s++) {
+      if (p.get_sector_generation(s) > generation) {
+        unsigned first = s << Proc::SECTOR_SHIFT;
+        unsigned last = first + (1 << Proc::SECTOR_SHIFT) - 1;
+        std::cout << std::format("'{:0>6o}-'{:0>6o} {:d}\n", first, last,
+                                 p.get_sector_generation(s));
+      }
+    }
+  }
+
+  return ok;
+}
+
 bool Monitor::disassemble(const std::vector<std::string> &args) {
   bool ok = true;
   std::string filename;
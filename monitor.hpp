@@ -36,6 +36,10 @@ namespace h16 {
     Monitor(Proc &p, int argc, char **argv);
     void do_commands(bool &run, std::ifstream &is);
     void sig_handler(int signo);
+
+    // In batch mode the end of a script quits, rather than
+    // carrying on at the terminal
+    void set_batch(bool b) { batch = b; }
     
   private:
     struct CmdTab {
@@ -65,6 +69,7 @@ namespace h16 {
     bool first_time;
     bool doing_commands;
     bool run;
+    bool batch;
 
     static const std::vector<std::string> instructions_text;
     static const std::vector<CmdTab> commands;
@@ -87,8 +92,13 @@ namespace h16 {
     bool go(const std::vector<std::string> &args);
     bool limit(const std::vector<std::string> &args);
     bool sbi(const std::vector<std::string> &args);
+    std::string condition_text(uint16_t addr, uint8_t kind);
+    bool brk(const std::vector<std::string> &args);
+    bool watch(const std::vector<std::string> &args);
+    bool iowatch(const std::vector<std::string> &args);
     bool ss(const std::vector<std::string> &args);
     bool ptr(const std::vector<std::string> &args);
+    bool ptr_turbo(const std::vector<std::string> &args);
     bool ptp(const std::vector<std::string> &args);
     bool plt(const std::vector<std::string> &args);
     bool lpt(const std::vector<std::string> &args);
@@ -103,6 +113,21 @@ namespace h16 {
     bool clear(const std::vector<std::string> &args);
     bool help(const std::vector<std::string> &args);
     bool trace(const std::vector<std::string> &args);
+    bool tmode(const std::vector<std::string> &args);
+    bool tfile(const std::vector<std::string> &args);
+    bool engine(const std::vector<std::string> &args);
+    bool profile(const std::vector<std::string> &args);
+    bool hotspots(const std::vector<std::string> &args);
+    bool calls(const std::vector<std::string> &args);
+    bool callgraph(const std::vector<std::string> &args);
+    bool stats(const std::vector<std::string> &args);
+    bool statslog(const std::vector<std::string> &args);
+    bool changed(const std::vector<std::string> &args);
+    bool idle(const std::vector<std::string> &args);
+    bool pace(const std::vector<std::string> &args);
+    bool save(const std::vector<std::string> &args);
+    bool restore(const std::vector<std::string> &args);
+    bool load(const std::vector<std::string> &args);
     bool disassemble(const std::vector<std::string> &args);
     bool vmem(const std::vector<std::string> &args);
     bool omem(const std::vector<std::string> &args);
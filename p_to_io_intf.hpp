@@ -25,6 +25,11 @@
 
 #include "io_types.hpp"
 
+namespace h16 {
+  class SnapshotWriter;
+  class SnapshotReader;
+}
+
 class PToIoIntf
 {
 public:
@@ -45,6 +50,35 @@ public:
 
   virtual void dmc(unsigned dmc_dev, // 0 to 15
                    int16_t &data, bool erl) = 0;
+
+  /*
+   * Snapshots (see Proc::save_snapshot()). A device saves what
+   * it needs to carry on where it left off, but not any file it
+   * has open; after a restore it is as if the tape or paper had
+   * been taken out. By default there is nothing to save.
+   */
+  virtual void save_state(h16::SnapshotWriter &w) const { }
+  virtual void restore_state(h16::SnapshotReader &r) { }
+
+  /*
+   * Turbo mode: a device that has one does its work as soon as the
+   * program asks, rather than taking as long as the real one would.
+   * Returns false if the device has no such mode.
+   */
+  virtual bool set_turbo(bool on) { return false; }
+  virtual bool get_turbo() const { return false; }
+
+  /*
+   * Small number for the device, so that statistics can be
+   * counted in an array: the I/O address it was first put at
+   * (see IoDispatch::device_id()), or its snapshot ID if it has
+   * no address. Set once, by whoever creates the device.
+   */
+  int get_id() const { return id; }
+  void set_id(int i) { id = i; }
+
+private:
+  int id = 0;
 };
 
 #define DEFINE_UNEXPECTED_INA(ClassName) IoStatus ClassName::ina(uint16_t instr, int16_t &data) { \
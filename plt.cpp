@@ -27,6 +27,7 @@
 #include "iodev.hpp"
 #include "stdtty.hpp"
 #include "proc.hpp"
+#include "snapshot.hpp"
 
 using namespace h16;
 
@@ -298,4 +299,36 @@ DEFINE_UNEXPECTED_INA(PLT)
 DEFINE_UNEXPECTED_OTA(PLT)
 DEFINE_UNEXPECTED_DMC(PLT)
 
+/*
+ * Snapshots
+ */
+void PLT::save_state(SnapshotWriter &w) const
+{
+  w.put_bool(ascii_file);
+  w.put8(phase);
+  w.put32(x_pos);
+  w.put32(y_pos);
+  w.put_bool(pen);
+  w.put16(mask);
+  w.put_bool(not_busy);
+  w.put8(current_direction);
+  w.put32(current_count);
+}
+
+void PLT::restore_state(SnapshotReader &r)
+{
+  if (fp) // The output file is not part of the snapshot
+    fclose(fp);
+  fp = NULL;
+  ascii_file = r.get_bool();
+  phase = static_cast<PHASE>(r.get8());
+  x_pos = r.get32();
+  y_pos = r.get32();
+  pen = r.get_bool();
+  mask = r.get16();
+  not_busy = r.get_bool();
+  current_direction = static_cast<PLT_DIRN>(r.get8());
+  current_count = r.get32();
+}
+
 DEFINE_STD_NAME(PLT)
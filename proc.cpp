@@ -22,11 +22,14 @@
 
 #include "proc.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <format>
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <thread>
 
 #include "iodev.hpp"
 #include "rtc.hpp"
@@ -35,10 +38,12 @@
 #include "plt.hpp"
 #include "asr_intf.hpp"
 #include "stdtty.hpp"
+#include "slst.hpp"
 #include "lpt.hpp"
 #include "plt.hpp"
 
 #include "instr.hpp"
+#include "snapshot.hpp"
 
 // How long is the start button depressed for (half_cycles)
 #define START_BUTTON_DOWN_TIME 1000
@@ -48,14 +53,27 @@ using namespace h16;
 Proc::Proc(bool hasEa)
   : CPU(hasEa)
   , goto_monitor_flag(false)
+  , break_hit(false)
   , exit_code(0)
   , exit_called(false)
+  , next_deadline(0)
+  , stop_time(UINT64_MAX)
+  , pace_rate(0.0)
+  , pace_half_cycles(0)
+  , pace_stats()
+  , stats_host(0.0)
+  , stats_half_cycles(0)
+  , run_half_cycles(0)
+  , in_run_until(false)
+  , stats_log_period(0)
+  , stats_log_next(UINT64_MAX)
   , ioDispatch(*this)
   , event_queue(*this)
 {
   master_clear();
 
   mfm = new Mfm(*this);
+  mfm->set_id(MFM_ID);
 }
 
 Proc::~Proc()
@@ -64,9 +82,7 @@ Proc::~Proc()
   delete mfm;
 }
 
-void Proc::do_instr(bool &run_flag, bool &monitor_flag) {
-  CPU::do_instr(run_flag);
-
+void Proc::service(bool &run_flag, bool &monitor_flag) {
   /*
    * If we're still running then service any
    * events that are due now.
@@ -74,6 +90,10 @@ void Proc::do_instr(bool &run_flag, bool &monitor_flag) {
    * events.
    */
   if (run_flag) {
+    if (pace_rate != 0.0)
+      pace();
+    if (get_half_cycles() >= stats_log_next)
+      write_stats_log();
     (void) event_queue.call_devices(get_half_cycles());
   } else {
     event_queue.flush_events(get_half_cycles_ref());
@@ -85,10 +105,73 @@ void Proc::do_instr(bool &run_flag, bool &monitor_flag) {
    */
   StdTty::service();
 
+  update_deadline();
+
   monitor_flag = goto_monitor_flag;
   goto_monitor_flag = false;
 }
 
+void Proc::update_deadline()
+{
+  uint64_t tty_poll = get_half_cycles() + TTY_POLL_HALF_CYCLES;
+  uint64_t event_time = event_queue.get_deadline();
+
+  next_deadline = std::min({event_time, tty_poll, stop_time, stats_log_next});
+}
+
+/*
+ * Run the processor for up to a number of instructions and/or
+ * half-cycles. The inner loop is in CPU::do_instrs() and only
+ * comes back out here when the deadline passes, when events
+ * are serviced exactly as do_instr() would.
+ */
+Proc::StopReason Proc::run_until(uint64_t instructions, uint64_t half_cycles)
+{
+  bool run_flag = true;
+  bool monitor_flag = false;
+  StopReason r = StopReason::BUDGET;
+
+  uint64_t now = get_half_cycles();
+  stop_time = (half_cycles > (UINT64_MAX - now)) ? UINT64_MAX : (now + half_cycles);
+  if (stop_time < next_deadline)
+    next_deadline = stop_time;
+
+  run_host = std::chrono::steady_clock::now();
+  run_half_cycles = now;
+  in_run_until = true;
+  break_hit = false;
+
+  while (instructions > 0) {
+    instructions = do_instrs(instructions, next_deadline, run_flag);
+
+    if (run_flag && (get_half_cycles() < next_deadline))
+      continue; // Instruction budget used up
+
+    service(run_flag, monitor_flag);
+
+    if (!run_flag) {
+      r = StopReason::HALT;
+      break;
+    } else if (monitor_flag) {
+      r = (break_hit) ? StopReason::BREAK : StopReason::MONITOR;
+      break;
+    } else if (get_half_cycles() >= stop_time) {
+      break;
+    } else if (get_waiting_for_input() &&
+               (event_queue.get_deadline() == EventQueue::NO_EVENT)) {
+      r = StopReason::WAIT; // and still nothing has turned up
+      break;
+    }
+  }
+
+  stop_time = UINT64_MAX;
+
+  stats_times(stats_host, stats_half_cycles);
+  in_run_until = false;
+
+  return r;
+}
+
 void Proc::exit(int code)
 {
   exit_code   = code;
@@ -98,11 +181,11 @@ void Proc::exit(int code)
 
 void Proc::set_limit(uint64_t half_cycles)
 {
-  event_queue.queue(get_half_cycles() + half_cycles, *mfm, Mfm::Event::LIMIT);
+  schedule(get_half_cycles() + half_cycles, *mfm, Mfm::Event::LIMIT);
 }
 void Proc::queue_sbi(uint64_t half_cycles)
 {
-  event_queue.queue(get_half_cycles() + half_cycles, *mfm, Mfm::Event::START_DOWN);
+  schedule(get_half_cycles() + half_cycles, *mfm, Mfm::Event::START_DOWN);
 }
 
 void Proc::event(int reason)
@@ -133,6 +216,38 @@ void Proc::event(int reason)
   }
 }
 
+/*
+ * Stop after the instruction (or DMC cycle) that hit a
+ * breakpoint or watchpoint, as for ALT-m, but with run_until()
+ * returning BREAK
+ */
+void Proc::watch_hit(const WatchHit &hit)
+{
+  const std::string by = (hit.dmc) ? std::string("DMC") : std::format("'{:0>6o}", hit.p);
+
+  switch (hit.kind) {
+  case WATCH_EXEC:
+    std::cout << std::format("\n{:0>10d}: break at '{:0>6o}\n",
+                             get_half_cycles(), hit.addr);
+    break;
+  case WATCH_READ:
+    std::cout << std::format("\n{:0>10d}: read '{:0>6o} from '{:0>6o} by {}\n",
+                             get_half_cycles(), hit.data, hit.addr, by);
+    break;
+  case WATCH_WRITE:
+    std::cout << std::format("\n{:0>10d}: write '{:0>6o} to '{:0>6o} by {}\n",
+                             get_half_cycles(), hit.data, hit.addr, by);
+    break;
+  case WATCH_IO:
+    std::cout << std::format("\n{:0>10d}: I/O '{:0>6o} to device '{:0>2o} by {}\n",
+                             get_half_cycles(), hit.data, hit.addr, by);
+    break;
+  }
+
+  break_hit = true;
+  goto_monitor();
+}
+
 /*****************************************************************
  * Master clear
  *****************************************************************/
@@ -141,8 +256,95 @@ void Proc::master_clear()
   CPU::master_clear();
 
   goto_monitor_flag = false;
+  break_hit = false;
   ioDispatch.master_clear_devices();
   event_queue.discard_events();
+  next_deadline = 0;
+}
+
+/*****************************************************************
+ * Snapshots
+ *****************************************************************/
+bool Proc::save_snapshot(const std::string &filename)
+{
+  SnapshotWriter w;
+
+  save_state(w);
+
+  w.begin("EVNT");
+  event_queue.save(w, [this](const PToIoIntf *d) {
+    return (d == mfm) ? MFM_ID : ioDispatch.device_id(d);
+  });
+  w.end();
+
+  ioDispatch.save_devices(w);
+
+  return w.write(filename);
+}
+
+/*
+ * The whole file is checked first, and the machine is left alone
+ * if it does not fit. Otherwise the restore starts from a master
+ * clear, so anything not in the snapshot is as after one.
+ */
+bool Proc::restore_snapshot(const std::string &filename)
+{
+  SnapshotReader r;
+
+  if (!r.open(filename))
+    return false;
+
+  if (!check_snapshot(r)) {
+    std::cerr << std::format("Could not restore snapshot <{}>\n", filename);
+    return false;
+  }
+  r.rewind();
+
+  master_clear();
+
+  bool ok = restore_state(r);
+
+  ok = ok && r.begin("EVNT");
+  ok = ok && event_queue.restore(r, [this](int id) -> PToIoIntf * {
+    return (id == MFM_ID) ? mfm : ioDispatch.device(id);
+  });
+  r.end();
+
+  ok = ok && ioDispatch.restore_devices(r);
+
+  if (!ok) {
+    // Should not happen, having passed the check
+    std::cerr << std::format("Could not restore snapshot <{}>\n", filename);
+    master_clear();
+    return false;
+  }
+
+  update_deadline();
+  if (pace_rate != 0.0)
+    set_pace(pace_rate);
+
+  return true;
+}
+
+/*
+ * Read through the same sections as restore_snapshot(), changing
+ * nothing
+ */
+bool Proc::check_snapshot(SnapshotReader &r)
+{
+  auto to_device = [this](int id) -> PToIoIntf * {
+    return (id == MFM_ID) ? mfm : ioDispatch.device(id);
+  };
+
+  bool ok = check_state(r);
+
+  ok = ok && r.begin("EVNT");
+  ok = ok && EventQueue::check(r, to_device);
+  r.end();
+
+  ok = ok && ioDispatch.check_devices(r);
+
+  return ok;
 }
 
 std::string Proc::get_file_name(const std::string &device_name,
@@ -160,6 +362,38 @@ std::string Proc::get_file_name(const std::string &device_name,
   return res;
 }
 
+/*****************************************************************
+ * Self-loading system tapes
+ *****************************************************************/
+bool Proc::load_system_tape(const std::string &filename)
+{
+  SystemTape tape;
+
+  if (!tape.read(filename))
+    return false;
+
+  for (const auto &block: tape.get_blocks()) {
+    uint16_t addr = block.addr;
+    for (uint16_t w: block.words)
+      deposit(addr++, w);
+  }
+
+  /*
+   * The bootstrap copies the key-in loader's OCP and INA to just
+   * in front of the loader, which uses them to read the tape, and
+   * it runs the loader in extended addressing mode
+   */
+  deposit(tape.get_loader_addr() - 2, read(2));
+  deposit(tape.get_loader_addr() - 1, read(3));
+
+  set_a(0);
+  set_b(0);
+  set_x(tape.get_end_addr());
+  set_halted(tape.get_halt_addr(), true);
+
+  return true;
+}
+
 void Proc::anomaly(Level level, const std::string &message) {
 
   static std::map<Level, const std::string> lnames {
@@ -196,35 +430,258 @@ bool Proc::jump_time_to_event(uint64_t &half_cycles) {
   return r;
 }
 
-void Proc::io_polling(uint16_t instr) {
+/*
+ * An idle loop can be skipped up to the next event (or the end
+ * of the run_until() budget), passing over TTY polls. With neither
+ * it is waiting for input, and this is UINT64_MAX. When pacing,
+ * stop at each TTY poll anyway so input is still seen promptly.
+ */
+uint64_t Proc::idle_deadline(uint64_t deadline) {
+  uint64_t r = std::min({event_queue.get_deadline(), stop_time, stats_log_next});
+
+  if ((pace_rate != 0.0) && (r != UINT64_MAX))
+    r = deadline;
+
+  return r;
+}
+
+/*****************************************************************
+ * Real-time pacing
+ *****************************************************************/
+void Proc::set_pace(double rate)
+{
+  pace_rate = rate;
+  pace_host = std::chrono::steady_clock::now();
+  pace_half_cycles = get_half_cycles();
+  pace_stats = PaceStats();
+}
 
-  // Currently this does nothing...
-  
-  // There are no events pending
-  //
-  // Are we waiting on the ASR for input?
-  //
-  // We could wait for keyboard input
-  // at this point, however this won't
-  // work for the case that there is a GUI
-  // frontpanel since that needs to be
-  // serviced too.
-  //
-  // Ideally we should return to the
-  // GUI code, remove the idle procedure
-  // and wait until a GUI event or keyboard
-  // input occurs before reinvoking the
-  // call to the kernel.
-  //
-  // However, this is a bit complicated
-  // so for now just let it poll the
-  // device
+/*
+ * A rate is a positive number (1 for real time), or "off" for 0
+ */
+bool Proc::parse_pace(const std::string &s, double &rate)
+{
+  char *end;
 
-  if ((instr & 077) == static_cast<uint16_t>(IoDispatch::Device::ASR)) {
-    // Ought to wait for keyboard or GUI
-  } else {
-    // Do something about apparent infinite loop?
+  if (s == "off") {
+    rate = 0.0;
+    return true;
   }
+
+  rate = strtod(s.c_str(), &end);
+  return (*end == '\0') && (end != s.c_str()) && (rate > 0.0) && (rate < 1e6);
+}
+
+/*
+ * Called from service(), so at least every TTY_POLL_HALF_CYCLES
+ */
+void Proc::pace()
+{
+  using namespace std::chrono;
+
+  const steady_clock::time_point now = steady_clock::now();
+  const double simulated = (double(get_half_cycles() - pace_half_cycles) *
+                            (cycle_time / 2.0) * 1e-6 / pace_rate);
+  const double elapsed = duration<double>(now - pace_host).count();
+  const double ahead = simulated - elapsed;
+
+  pace_stats.drift = ahead;
+  pace_stats.max_ahead = std::max(pace_stats.max_ahead, ahead);
+  pace_stats.max_behind = std::max(pace_stats.max_behind, -ahead);
+
+  if (ahead >= PACE_SLICE) {
+    std::this_thread::sleep_until(pace_host +
+                                  duration_cast<steady_clock::duration>(duration<double>(simulated)));
+    pace_stats.sleeps++;
+    pace_stats.slept += ahead;
+  } else if (ahead < -PACE_MAX_BEHIND) {
+    pace_host = now;
+    pace_half_cycles = get_half_cycles();
+    pace_stats.resyncs++;
+  }
+}
+
+/*****************************************************************
+ * Performance counters
+ *****************************************************************/
+
+/*
+ * Host and simulated time so far, including the run_until() that
+ * is going on now, if any
+ */
+void Proc::stats_times(double &host, uint64_t &half_cycles)
+{
+  host = stats_host;
+  half_cycles = stats_half_cycles;
+  if (in_run_until) {
+    host += std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                          run_host).count();
+    half_cycles += get_half_cycles() - run_half_cycles;
+  }
+}
+
+void Proc::clear_stats()
+{
+  CPU::clear_stats();
+  event_queue.clear_stats();
+  ioDispatch.clear_io_counts();
+  stats_host = 0.0;
+  stats_half_cycles = 0;
+  run_host = std::chrono::steady_clock::now();
+  run_half_cycles = get_half_cycles();
+}
+
+/*
+ * Events dispatched, by device name (a device at more than
+ * one address is only counted once, under its first)
+ */
+void Proc::event_counts(std::map<std::string, uint64_t> &events, uint64_t &total) const
+{
+  const EventQueue::DispatchCounts &counts = event_queue.get_dispatched();
+  total = 0;
+  for (int id = 0; id < EventQueue::DEVICE_IDS; id++) {
+    if (counts[id]) {
+      const PToIoIntf *d = (id == MFM_ID) ? mfm : ioDispatch.device(id);
+      events[IoDispatch::device_name(d)] += counts[id];
+      total += counts[id];
+    }
+  }
+}
+
+void Proc::print_stats()
+{
+  const Stats &s = get_stats();
+  double host;
+  uint64_t hc;
+  stats_times(host, hc);
+  const double simulated = double(hc) * (cycle_time / 2.0) * 1e-6;
+
+  std::cout << std::format("Instructions: {:d} in {:.3f}s host time ({:.2f} MIPS)\n",
+                           s.instructions, host,
+                           (host > 0.0) ? (double(s.instructions) * 1e-6 / host) : 0.0);
+  std::cout << std::format("Simulated: {:.3f}s, {:.2f}x real time\n", simulated,
+                           (host > 0.0) ? (simulated / host) : 0.0);
+  std::cout << std::format("Interrupts: {:d}, DMC cycles: {:d}\n",
+                           s.interrupts, s.dmc_cycles);
+  std::cout << std::format("Idle loops skipped: {:d} ({:d} half-cycles), "
+                           "I/O poll jumps: {:d} ({:d} half-cycles)\n",
+                           s.idle_skips, s.idle_skipped,
+                           s.io_poll_jumps, s.io_poll_skipped);
+
+  std::map<std::string, uint64_t> events;
+  uint64_t total;
+  event_counts(events, total);
+  std::cout << std::format("Events: {:d}, most pending {:d}\n",
+                           total, event_queue.get_high_water());
+  for (auto &e: events)
+    std::cout << std::format("  {:<8} {:>12d}\n", e.first, e.second);
+
+  std::cout << std::format("I/O instructions (SMK: {:d}):\n", ioDispatch.get_smk_count());
+  std::cout << "  dev  name            ocp          sks          ina          ota\n";
+  for (unsigned i = 0; i < 64; i++) {
+    uint64_t n[IoDispatch::IO_KINDS];
+    uint64_t all = 0;
+    for (unsigned k = 0; k < IoDispatch::IO_KINDS; k++)
+      all += (n[k] = ioDispatch.get_io_count(i, IoDispatch::IoKind(k)));
+    if (all)
+      std::cout << std::format("  '{:0>2o}  {:<4} {:>12d} {:>12d} {:>12d} {:>12d}\n", i,
+                               IoDispatch::device_name(ioDispatch.device(i)),
+                               n[0], n[1], n[2], n[3]);
+  }
+}
+
+bool Proc::set_stats_log(const std::string &filename, double seconds)
+{
+  if (seconds <= 0.0)
+    return false;
+
+  close_stats_log();
+  stats_log.open(filename, std::ios::app);
+  if (!stats_log) {
+    std::cerr << std::format("Could not open <{}>\n", filename);
+    return false;
+  }
+
+  stats_log_period = std::max(uint64_t(1),
+                              uint64_t(seconds * 1e6 * half_cycles_per_microsecond));
+  stats_log_next = get_half_cycles() + stats_log_period;
+  next_deadline = 0;
+  return true;
+}
+
+void Proc::close_stats_log()
+{
+  if (stats_log.is_open())
+    stats_log.close();
+  stats_log_next = UINT64_MAX;
+}
+
+/*
+ * One JSON object per line
+ */
+void Proc::write_stats_log()
+{
+  static const char *kinds[] = {"ocp", "sks", "ina", "ota"};
+  const Stats &s = get_stats();
+  double host;
+  uint64_t hc;
+  stats_times(host, hc);
+  const double simulated = double(hc) * (cycle_time / 2.0) * 1e-6;
+
+  stats_log << std::format("{{\"half_cycles\":{:d},\"simulated\":{:.6f},\"host\":{:.6f},"
+                           "\"instructions\":{:d},\"mips\":{:.3f},\"ratio\":{:.3f},"
+                           "\"interrupts\":{:d},\"dmc_cycles\":{:d},"
+                           "\"idle_skips\":{:d},\"idle_skipped\":{:d},"
+                           "\"io_poll_jumps\":{:d},\"io_poll_skipped\":{:d},"
+                           "\"events_pending_max\":{:d}",
+                           get_half_cycles(), simulated, host, s.instructions,
+                           (host > 0.0) ? (double(s.instructions) * 1e-6 / host) : 0.0,
+                           (host > 0.0) ? (simulated / host) : 0.0,
+                           s.interrupts, s.dmc_cycles, s.idle_skips, s.idle_skipped,
+                           s.io_poll_jumps, s.io_poll_skipped,
+                           event_queue.get_high_water());
+
+  std::map<std::string, uint64_t> events;
+  uint64_t total;
+  event_counts(events, total);
+  const char *sep = "";
+  stats_log << ",\"events\":{";
+  for (auto &e: events) {
+    stats_log << std::format("{}\"{}\":{:d}", sep, e.first, e.second);
+    sep = ",";
+  }
+
+  stats_log << std::format("}},\"smk\":{:d},\"io\":[", ioDispatch.get_smk_count());
+  sep = "";
+  for (unsigned i = 0; i < 64; i++) {
+    std::string counts;
+    uint64_t all = 0;
+    for (unsigned k = 0; k < IoDispatch::IO_KINDS; k++) {
+      const uint64_t n = ioDispatch.get_io_count(i, IoDispatch::IoKind(k));
+      counts += std::format(",\"{}\":{:d}", kinds[k], n);
+      all += n;
+    }
+    if (all) {
+      stats_log << std::format("{}{{\"dev\":\"{:0>2o}\",\"name\":\"{}\"{}}}", sep, i,
+                               IoDispatch::device_name(ioDispatch.device(i)), counts);
+      sep = ",";
+    }
+  }
+  stats_log << "]}" << std::endl;
+
+  stats_log_next += stats_log_period;
+  if (stats_log_next <= get_half_cycles())
+    stats_log_next = get_half_cycles() + stats_log_period;
+}
+
+void Proc::io_polling(uint16_t instr [[maybe_unused]]) {
+
+  // Currently this does nothing...
+
+  // There are no events pending. Waiting for the ASR keyboard
+  // (or anything else from outside) is done by run_until()
+  // returning WAIT once the idle loop detection has seen the
+  // polling loop go round unchanged.
 }
 
 
@@ -247,7 +704,7 @@ void Proc::start_button()
 
   set_sbi(true);
 
-  event_queue.queue(get_half_cycles() + START_BUTTON_DOWN_TIME, *mfm, Mfm::Event::START_UP);
+  schedule(get_half_cycles() + START_BUTTON_DOWN_TIME, *mfm, Mfm::Event::START_UP);
 }
 
 std::string Proc::dis()
@@ -258,6 +715,7 @@ std::string Proc::dis()
 void Proc::flush_events()
 {
   event_queue.flush_events(get_half_cycles_ref());
+  next_deadline = 0;
 }
 
 
@@ -333,11 +791,21 @@ void Proc::dmc(unsigned dmc_dev, int16_t &data, bool erl) {
 
 bool Proc::dump_trace(const std::string &filename, unsigned n) {
 
-  const unsigned TRACE_BUF(btrace_buf.size());
+  const unsigned TRACE_BUF(get_trace_entries());
   
   unsigned i;
   std::ofstream ofs;
 
+  if ((get_trace_mode() == TraceMode::OFF) ||
+      (get_trace_mode() == TraceMode::STREAM)) {
+    std::cerr << std::format("No trace in memory (trace mode is {})\n",
+                             trace_mode_name(get_trace_mode()));
+    return false;
+  }
+
+  if ((n == 0) || (n > TRACE_BUF))
+    n = TRACE_BUF;
+
   /*
    * If a filename is passed then open it.
    */
@@ -353,44 +821,58 @@ bool Proc::dump_trace(const std::string &filename, unsigned n) {
   
   i = (trace_ptr + TRACE_BUF - n) % TRACE_BUF;
 
-  do {
-    if (btrace_buf[i].v) {
-      if (btrace_buf[i].brk && (btrace_buf[i].instr < 16)) {
-        uint16_t dmc_addr, dmc_data;
-        bool dmc_erl, dmc_wrt;
-        dmc_data = btrace_buf[i].p & 0xffff;
-        dmc_addr = btrace_buf[i].y & 0xffff;
-        dmc_erl  = btrace_buf[i].c;
-
-        dmc_wrt = ((dmc_addr & 0x8000) != 0);
-        dmc_addr &= 0x7fff;
-
-        os << std::format("{:0>10d}: {} {:0>6o} {} {:0>5o} {} {}\n",
-                          btrace_buf[i].half_cycles,
-                          ((dmc_wrt) ? "Write" : "Read"), dmc_data,
-                          ((dmc_wrt) ? "to " : "from"), dmc_addr,
-                          ((dmc_erl) ? "ERL" : "   "),
-                          instr_table.disassemble(btrace_buf[i].p,
-                                                  btrace_buf[i].instr,
-                                                  btrace_buf[i].brk,
-                                                  btrace_buf[i].y,
-                                                  true/*y_valid*/).c_str());
-      } else {
-        os << std::format("{:0>10d}: A:{:0>6o} B:{:0>6o} X:{:0>6o} C:{:1d} {}\n",
-                          btrace_buf[i].half_cycles,
-                          (btrace_buf[i].a & 0xffff),
-                          (btrace_buf[i].b & 0xffff),
-                          (btrace_buf[i].x & 0xffff),
-                          (btrace_buf[i].c & 1),
-                          instr_table.disassemble(btrace_buf[i].p,
-                                                  btrace_buf[i].instr,
-                                                  btrace_buf[i].brk,
-                                                  btrace_buf[i].y,
-                                                  true/*y_valid*/).c_str());
+  if (get_trace_mode() == TraceMode::PC) {
+    do {
+      const PCtrace &t(pctrace_buf[i]);
+      if (t.v) {
+        if (t.p == 0xffff) {
+          os << instr_table.disassemble(0, t.instr, true) << '\n';
+        } else {
+          os << instr_table.disassemble(t.p, t.instr, false) << '\n';
+        }
       }
-    }
-    i = (i+1) % TRACE_BUF;
-  } while (trace_ptr != i);
+      i = (i+1) % TRACE_BUF;
+    } while (trace_ptr != i);
+  } else {
+    do {
+      if (btrace_buf[i].v) {
+        if (btrace_buf[i].brk && (btrace_buf[i].instr < 16)) {
+          uint16_t dmc_addr, dmc_data;
+          bool dmc_erl, dmc_wrt;
+          dmc_data = btrace_buf[i].p & 0xffff;
+          dmc_addr = btrace_buf[i].y & 0xffff;
+          dmc_erl  = btrace_buf[i].c;
+
+          dmc_wrt = ((dmc_addr & 0x8000) != 0);
+          dmc_addr &= 0x7fff;
+
+          os << std::format("{:0>10d}: {} {:0>6o} {} {:0>5o} {} {}\n",
+                            btrace_buf[i].half_cycles,
+                            ((dmc_wrt) ? "Write" : "Read"), dmc_data,
+                            ((dmc_wrt) ? "to " : "from"), dmc_addr,
+                            ((dmc_erl) ? "ERL" : "   "),
+                            instr_table.disassemble(btrace_buf[i].p,
+                                                    btrace_buf[i].instr,
+                                                    btrace_buf[i].brk,
+                                                    btrace_buf[i].y,
+                                                    true/*y_valid*/).c_str());
+        } else {
+          os << std::format("{:0>10d}: A:{:0>6o} B:{:0>6o} X:{:0>6o} C:{:1d} {}\n",
+                            btrace_buf[i].half_cycles,
+                            (btrace_buf[i].a & 0xffff),
+                            (btrace_buf[i].b & 0xffff),
+                            (btrace_buf[i].x & 0xffff),
+                            (btrace_buf[i].c & 1),
+                            instr_table.disassemble(btrace_buf[i].p,
+                                                    btrace_buf[i].instr,
+                                                    btrace_buf[i].brk,
+                                                    btrace_buf[i].y,
+                                                    true/*y_valid*/).c_str());
+        }
+      }
+      i = (i+1) % TRACE_BUF;
+    } while (trace_ptr != i);
+  }
 
   if (ofs.is_open()) {
     ofs.close();
@@ -437,6 +919,210 @@ bool Proc::dump_disassemble(const std::string &filename, unsigned first, unsigne
   return true;
 }
 
+/*****************************************************************
+ * Profile report: the n addresses where most time was spent and
+ * the mix of instruction types. If a filename is passed the count
+ * for every address executed is written to it as well, one
+ * tab-separated line each.
+ *****************************************************************/
+
+bool Proc::dump_profile(const std::string &filename, unsigned n) {
+  static const char *type_names[] = {
+    "UD", "GB", "SH", "SK", "GA", "MR", "IO", "IG"
+  };
+  const unsigned NTYPES = sizeof(type_names) / sizeof(type_names[0]);
+
+  if (profile.empty()) {
+    std::cerr << "No profile (profile is off)\n";
+    return false;
+  }
+
+  if (n == 0)
+    n = 20;
+
+  std::vector<unsigned> addrs;
+  ProfileCount total {};
+  for (unsigned i = 0; i < profile.size(); i++) {
+    if (profile[i].count) {
+      addrs.push_back(i);
+      total.count += profile[i].count;
+      total.half_cycles += profile[i].half_cycles;
+    }
+  }
+
+  if (filename.size() > 0) {
+    std::ofstream ofs(filename);
+    if (!ofs) {
+      std::cerr << std::format("Could not open <{}>\n", filename);
+      return false;
+    }
+    ofs << "addr\tcount\thalf_cycles\tinstr\ttype\n";
+    for (unsigned i: addrs) {
+      ofs << std::format("{:0>6o}\t{:d}\t{:d}\t{:0>6o}\t{}\n", i,
+                         profile[i].count, profile[i].half_cycles, core[i],
+                         type_names[instr_table.type(core[i])]);
+    }
+  }
+
+  auto percent = [](uint64_t part, uint64_t whole) {
+    return (whole) ? (100.0 * double(part) / double(whole)) : 0.0;
+  };
+
+  std::cout << std::format("Profile: {:d} instructions, {:d} half-cycles\n",
+                           total.count, total.half_cycles);
+  std::cout << std::format("Breaks: {:d}, {:d} half-cycles; idle loops skipped: {:d} half-cycles\n",
+                           profile_breaks.count, profile_breaks.half_cycles,
+                           get_idle_skipped() - profile_idle_skipped);
+
+  std::stable_sort(addrs.begin(), addrs.end(), [this](unsigned a, unsigned b) {
+    return profile[a].half_cycles > profile[b].half_cycles;
+  });
+  if (addrs.size() > n)
+    addrs.resize(n);
+
+  std::cout << "\n       count      %   half_cycles      %  instruction\n";
+  for (unsigned i: addrs) {
+    std::cout << std::format("{:>12d} {:>6.2f} {:>13d} {:>6.2f}  {}\n",
+                             profile[i].count, percent(profile[i].count, total.count),
+                             profile[i].half_cycles,
+                             percent(profile[i].half_cycles, total.half_cycles),
+                             (instr_table.defined(core[i])) ?
+                             instr_table.disassemble(i, core[i], false) :
+                             std::format("{:0>6o}  {:0>6o}    ???", i, core[i]));
+  }
+
+  std::vector<ProfileCount> mix(NTYPES);
+  for (unsigned op = 0; op < profile_ops.size(); op++) {
+    ProfileCount &m = mix[instr_table.type(op)];
+    m.count += profile_ops[op].count;
+    m.half_cycles += profile_ops[op].half_cycles;
+  }
+
+  std::cout << "\ntype        count      %   half_cycles      %\n";
+  for (unsigned t = 0; t < NTYPES; t++) {
+    if (mix[t].count) {
+      std::cout << std::format("{:<4} {:>12d} {:>6.2f} {:>13d} {:>6.2f}\n", type_names[t],
+                               mix[t].count, percent(mix[t].count, total.count),
+                               mix[t].half_cycles,
+                               percent(mix[t].half_cycles, total.half_cycles));
+    }
+  }
+
+  return true;
+}
+
+/*****************************************************************
+ * Call graph report: the n subroutines where most time was spent
+ * (including their callees) and the call stack as it is now. If a
+ * filename is passed the exclusive time of every node of the call
+ * tree is written to it as a folded stack, one line each, as read
+ * by flame graph tools:
+ *
+ *   main;001000;002000 1234
+ *****************************************************************/
+
+bool Proc::dump_callgraph(const std::string &filename, unsigned n) {
+  struct Sub {
+    uint64_t calls;
+    uint64_t inclusive;
+    uint64_t exclusive;
+  };
+
+  if (call_nodes.empty()) {
+    std::cerr << "No call graph (calls is off)\n";
+    return false;
+  }
+
+  if (n == 0)
+    n = 20;
+
+  if (call_tracing)
+    call_charge();
+
+  auto name = [this](uint32_t node) {
+    return (call_nodes[node].entry == CALL_ROOT) ? std::string("main") :
+      std::format("{:0>6o}", call_nodes[node].entry);
+  };
+
+  /*
+   * Children always come after their parent, so one pass
+   * backwards sums each subtree.
+   */
+  std::vector<uint64_t> inclusive(call_nodes.size());
+  for (size_t i = call_nodes.size(); i-- > 0; ) {
+    inclusive[i] += call_nodes[i].half_cycles;
+    if (i > 0)
+      inclusive[call_nodes[i].parent] += inclusive[i];
+  }
+
+  if (filename.size() > 0) {
+    std::ofstream ofs(filename);
+    if (!ofs) {
+      std::cerr << std::format("Could not open <{}>\n", filename);
+      return false;
+    }
+    for (uint32_t i = 0; i < call_nodes.size(); i++) {
+      if (call_nodes[i].half_cycles) {
+        std::string stack = name(i);
+        for (uint32_t j = i; j > 0; ) {
+          j = call_nodes[j].parent;
+          stack = name(j) + ";" + stack;
+        }
+        ofs << std::format("{} {:d}\n", stack, call_nodes[i].half_cycles);
+      }
+    }
+  }
+
+  /*
+   * A subroutine is never on the stack twice, so adding up the
+   * inclusive time of its nodes counts nothing twice.
+   */
+  std::map<uint32_t, Sub> subs;
+  uint64_t total_calls = 0;
+  for (uint32_t i = 0; i < call_nodes.size(); i++) {
+    Sub &s = subs[call_nodes[i].entry];
+    s.calls += call_nodes[i].calls;
+    s.inclusive += inclusive[i];
+    s.exclusive += call_nodes[i].half_cycles;
+    if (i > 0)
+      total_calls += call_nodes[i].calls;
+  }
+
+  auto percent = [](uint64_t part, uint64_t whole) {
+    return (whole) ? (100.0 * double(part) / double(whole)) : 0.0;
+  };
+
+  const uint64_t total = inclusive[0];
+  std::cout << std::format("Call graph: {:d} subroutines, {:d} calls, {:d} half-cycles\n",
+                           subs.size() - 1, total_calls, total);
+
+  std::string stack;
+  for (uint32_t node: call_stack)
+    stack += " " + name(node);
+  std::cout << std::format("Stack:{}\n", stack);
+
+  std::vector<uint32_t> entries;
+  for (auto &s: subs)
+    entries.push_back(s.first);
+  std::stable_sort(entries.begin(), entries.end(), [&subs](uint32_t a, uint32_t b) {
+    return subs[a].inclusive > subs[b].inclusive;
+  });
+  if (entries.size() > n)
+    entries.resize(n);
+
+  std::cout << "\n       calls     inclusive      %     exclusive      %  entry\n";
+  for (uint32_t e: entries) {
+    const Sub &s = subs[e];
+    std::cout << std::format("{:>12d} {:>13d} {:>6.2f} {:>13d} {:>6.2f}  {}\n",
+                             s.calls, s.inclusive, percent(s.inclusive, total),
+                             s.exclusive, percent(s.exclusive, total),
+                             (e == CALL_ROOT) ? std::string("main") :
+                             std::format("{:0>6o}", e));
+  }
+
+  return true;
+}
+
 bool Proc::dump_vmem(const std::string &filename, unsigned exec_addr, bool octal) {
   unsigned i;
   uint16_t instr;
@@ -25,6 +25,9 @@
 
 #include <vector>
 #include <cstdint>
+#include <chrono>
+#include <fstream>
+#include <map>
 
 #include "cpu.hpp"
 #include "instr.hpp"
@@ -42,21 +45,83 @@ namespace h16 {
     Proc(bool HasEa);
     virtual ~Proc();
 
-    void do_instr(bool &run_flag, bool &monitor_flag);
+    /*
+     * Why run_until() returned
+     */
+    enum class StopReason {
+      HALT,    // processor halted (or exit was called)
+      MONITOR, // monitor requested (ALT-m, limit, ...)
+      BREAK,   // breakpoint or watchpoint hit (see watch_hit())
+      BUDGET,  // instruction or half-cycle budget used up
+      WAIT     // nothing to do until there is input (see StdTty::wait())
+    };
+
+    StopReason run_until(uint64_t instructions,
+                         uint64_t half_cycles = UINT64_MAX);
+
+    void do_instr(bool &run_flag, bool &monitor_flag) {
+      CPU::do_instr(run_flag);
+
+      /*
+       * Fast path: still running and nothing (event, TTY
+       * poll or monitor request) due yet.
+       */
+      if (run_flag && (get_half_cycles() < next_deadline)) {
+        monitor_flag = false;
+        return;
+      }
+      service(run_flag, monitor_flag);
+    }
  
     void exit(int code);
     bool get_exit_called(int &code){code = exit_code; return exit_called;}
 
     void start_button();
-    void goto_monitor() { goto_monitor_flag = true; }
+    void goto_monitor() { goto_monitor_flag = true; next_deadline = 0; }
     void set_limit(uint64_t half_cycles);
     void queue_sbi(uint64_t half_cycles);
+
+    /*
+     * Real-time pacing. At a rate of zero (the default) the machine
+     * runs flat out. Otherwise half_cycles is kept in step with the
+     * host clock, at rate times the speed of the real machine:
+     * sleeping when ahead, running flat out to catch up when behind,
+     * and giving up and starting again from the current time when
+     * too far behind to catch up (after the monitor, say).
+     */
+    struct PaceStats {
+      double drift;      // seconds ahead (+) or behind (-) last time
+      double max_ahead;  // seconds
+      double max_behind; // seconds
+      uint64_t sleeps;
+      double slept;      // seconds
+      uint64_t resyncs;
+    };
+    void set_pace(double rate);
+    static bool parse_pace(const std::string &s, double &rate);
+    double get_pace() { return pace_rate; }
+    const PaceStats &get_pace_stats() { return pace_stats; }
+
+    /*
+     * Performance counters: those of the CPU, the event queue and
+     * the I/O dispatcher, with the host time spent and simulated
+     * time run inside run_until() (so not counting time sat in
+     * the monitor). With a stats log open a JSON line of the lot
+     * is appended to it every so many seconds of simulated time.
+     */
+    void clear_stats();
+    void print_stats();
+    bool set_stats_log(const std::string &filename, double seconds);
+    void close_stats_log();
+    bool get_stats_log() { return stats_log.is_open(); }
   
     std::string dis();
     void flush_events();
   
     void set_filename(IoDispatch::Device dev, const std::string &filename, int subdevice = 0); 
     void send_event(IoDispatch::Device dev, unsigned reason);
+    bool set_turbo(IoDispatch::Device dev, bool on) { return ioDispatch.set_turbo(dev, on); }
+    bool get_turbo(IoDispatch::Device dev) { return ioDispatch.get_turbo(dev); }
 
     bool special(char k);
 
@@ -70,8 +135,7 @@ namespace h16 {
     }
     void queue_hc(uint64_t half_cycles, PToIoIntf &device, int reason)
     {
-      uint64_t event_time = get_half_cycles() + half_cycles;
-      event_queue.queue(event_time, device, reason);
+      schedule(get_half_cycles() + half_cycles, device, reason);
     }
     uint64_t get_half_cycles() {
       return CPU::get_half_cycles();
@@ -96,21 +160,81 @@ namespace h16 {
     virtual void smk(uint16_t mask);
     virtual void event(IoDevice dev, int reason);
     virtual bool jump_time_to_event(uint64_t &half_cycles);
+    virtual uint64_t idle_deadline(uint64_t deadline);
+    virtual void watch_hit(const WatchHit &hit);
     virtual void io_polling(uint16_t instr);
     virtual void dmc(unsigned dmc_dev, // 0 to 15
                      int16_t &data, bool erl);
 
     bool dump_trace(const std::string &filename, unsigned n);
     bool dump_disassemble(const std::string &filename, unsigned first, unsigned last);
+    bool dump_profile(const std::string &filename, unsigned n);
+    bool dump_callgraph(const std::string &filename, unsigned n);
     bool dump_vmem(const std::string &, unsigned exec_addr, bool octal=false);
     bool dump_coemem(const std::string &, unsigned exec_addr);
 
+    /*
+     * Snapshot the whole machine (processor, memory, devices and
+     * pending events) to a file, and restore from one
+     */
+    bool save_snapshot(const std::string &filename);
+    bool restore_snapshot(const std::string &filename);
+
+    /*
+     * Put a self-loading system tape straight into core, leaving the
+     * machine as the tape's own loader would after reading it
+     */
+    bool load_system_tape(const std::string &filename);
+
   private:
     Mfm *mfm;
 
     bool goto_monitor_flag;
+    bool break_hit; // goto_monitor() was for a watch_hit()
     int exit_code;
     bool exit_called;
+
+    /*
+     * The earliest half-cycle time at which do_instr() must leave
+     * the fast path: the next queued event or the next time the
+     * TTY should be polled, whichever is sooner. Set to zero to
+     * force a trip through service() after the next instruction.
+     */
+    volatile uint64_t next_deadline;
+    uint64_t stop_time; // End of the run_until() half-cycle budget
+
+    double pace_rate; // 0 for no pacing
+    std::chrono::steady_clock::time_point pace_host;
+    uint64_t pace_half_cycles; // half_cycles at pace_host
+    PaceStats pace_stats;
+    static const int MFM_ID = 0100; // Snapshot ID, after the I/O devices
+    static_assert(MFM_ID < EventQueue::DEVICE_IDS);
+    void event_counts(std::map<std::string, uint64_t> &events, uint64_t &total) const;
+    bool check_snapshot(SnapshotReader &r);
+    static constexpr double PACE_SLICE = 0.001;     // Shortest sleep
+    static constexpr double PACE_MAX_BEHIND = 0.1;  // Then resync
+    void pace();
+    static const uint64_t TTY_POLL_HALF_CYCLES = 4096;
+
+    double stats_host;          // seconds inside run_until()
+    uint64_t stats_half_cycles; // simulated inside run_until()
+    std::chrono::steady_clock::time_point run_host; // run_until() entry
+    uint64_t run_half_cycles;   // half_cycles at run_host
+    bool in_run_until;
+    std::ofstream stats_log;
+    uint64_t stats_log_period;  // half-cycles
+    uint64_t stats_log_next;    // UINT64_MAX with no log
+    void stats_times(double &host, uint64_t &half_cycles);
+    void write_stats_log();
+
+    void service(bool &run_flag, bool &monitor_flag);
+    void update_deadline();
+    void schedule(uint64_t event_time, PToIoIntf &device, int reason)
+    {
+      event_queue.queue(event_time, device, reason);
+      if (event_time < next_deadline)
+        next_deadline = event_time;
+    }
   
     /*
      * Instruction decode & dispatch
@@ -27,6 +27,7 @@
 #include "iodev.hpp"
 #include "stdtty.hpp"
 #include "proc.hpp"
+#include "snapshot.hpp"
 
 #define SPEED 110 // characters per second
 #define SMK_MASK (1 << (16-10))
@@ -199,4 +200,22 @@ void PTP::set_filename(const std::string &filename, unsigned subdevice) {
 
 DEFINE_UNEXPECTED_DMC(PTP)
 
+/*
+ * Snapshots
+ */
+void PTP::save_state(SnapshotWriter &w) const
+{
+  w.put_bool(ready);
+  w.put_bool(power_on);
+  w.put16(mask);
+}
+
+void PTP::restore_state(SnapshotReader &r)
+{
+  tty_file.close(); // The tape is not part of the snapshot
+  ready = r.get_bool();
+  power_on = r.get_bool();
+  mask = r.get16();
+}
+
 DEFINE_STD_NAME(PTP)
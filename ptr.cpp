@@ -29,6 +29,7 @@
 #include "iodev.hpp"
 #include "stdtty.hpp"
 #include "proc.hpp"
+#include "snapshot.hpp"
 
 #define SPEED 1000 // charcters per second
 #define SMK_MASK (1 << (16-9))
@@ -48,12 +49,19 @@
  * from the file have the MSB forced to one. A '\n' read from
  * the file is translated into a CR-LF sequence.
  *
+ * In turbo mode the reader takes no time: while the tape is
+ * running there is always a character ready when the program
+ * looks (or, with the interrupt enabled, as soon as the last one
+ * has been taken), so reading a tape costs no more than the
+ * instructions that do it. Programs that time the reader need
+ * the normal mode.
  */
 
 using namespace h16;
 
 PTR::PTR(IoToPIntf &p)
   : IoDev(p)
+  , turbo(false)
 {
   master_clear();
 }
@@ -78,6 +86,9 @@ void PTR::master_clear()
 
 IoStatus PTR::ina(uint16_t instr, int16_t &data)
 {
+  if (turbo)
+    next_character();
+
   bool r = ready;
 
   if (ready) {
@@ -86,6 +97,8 @@ IoStatus PTR::ina(uint16_t instr, int16_t &data)
     p.clear_interrupt(SMK_MASK);
     data_count ++;
     //printf("\nPTR: Read character (%d) %d\n", data_buf, data_count);
+    if (turbo && mask)
+      next_character();
   } else if (eot) {
     eot_counter++;
     
@@ -158,9 +171,44 @@ void PTR::open_file()
 
 void PTR::start_reader()
 {
-  p.queue((1000000 / SPEED), *this, Event::CHARACTER );
-  events_queued++;
   tape_running = true;
+
+  if (turbo) {
+    if (mask)
+      next_character();
+  } else {
+    p.queue((1000000 / SPEED), *this, Event::CHARACTER );
+    events_queued++;
+  }
+}
+
+/*
+ * Read the next character from the tape into the buffer
+ */
+bool PTR::read_character()
+{
+  int c = tty_file.getc();
+
+  if (c == EOF) {
+    eot = true;
+    eot_counter = 0;
+    return false;
+  }
+
+  data_buf = c & 0xff;
+  ready = true;
+  p.set_interrupt(mask);
+  return true;
+}
+
+/*
+ * Turbo mode: the next character arrives as soon as there is room
+ * for it
+ */
+void PTR::next_character()
+{
+  if (tape_running && (!ready) && (!eot))
+    (void) read_character();
 }
 
 void PTR::ocp(uint16_t instr)
@@ -201,6 +249,9 @@ void PTR::ocp(uint16_t instr)
 IoStatus PTR::sks(uint16_t instr)
 {
   bool r = 0;
+
+  if (turbo)
+    next_character();
   
   switch(instr & 0700) {
   case 0000: r = ready; break;
@@ -217,6 +268,9 @@ void PTR::smk(uint16_t mask)
 {
   this->mask = mask & SMK_MASK;
   
+  if (turbo && this->mask)
+    next_character();
+
   if (ready && this->mask)
     p.set_interrupt(this->mask);
   else
@@ -235,22 +289,15 @@ void PTR::event(int reason)
   case Event::CHARACTER:
     events_queued--;
     
-    if (!ignore_event) {
+    // In turbo mode characters are read on demand instead
+    if ((!ignore_event) && (!turbo)) {
       if (ready) {
         std::stringstream ss;
         ss << std::dec << p.get_half_cycles() << " Character overrun";
         p.anomaly(IoToPIntf::Level::WARNING, message(ss.str()));
       }
       
-      int c = tty_file.getc();
-
-      if (c == EOF) {
-        eot = true;
-        eot_counter = 0;
-      } else {
-        data_buf = c & 0xff;
-        ready = true;
-        p.set_interrupt(mask);
+      if (read_character()) {
         p.queue((1000000 / SPEED), *this, Event::CHARACTER );
         events_queued++;
       }
@@ -277,7 +324,50 @@ void PTR::set_filename(const std::string &filename, unsigned subdevice) {
   this->filename = filename;
 }
 
+bool PTR::set_turbo(bool on)
+{
+  turbo = on;
+
+  // Back to normal, a running tape needs its next character queued
+  if ((!turbo) && tape_running && (!eot) && (events_queued == 0)) {
+    p.queue((1000000 / SPEED), *this, Event::CHARACTER );
+    events_queued++;
+  }
+
+  return true;
+}
+
 DEFINE_UNEXPECTED_OTA(PTR)
 DEFINE_UNEXPECTED_DMC(PTR)
 
+/*
+ * Snapshots
+ */
+void PTR::save_state(SnapshotWriter &w) const
+{
+  w.put_bool(eot);
+  w.put32(eot_counter);
+  w.put16(mask);
+  w.put_bool(tape_running);
+  w.put_bool(ready);
+  w.put8(data_buf);
+  w.put_bool(ignore_event);
+  w.put32(events_queued);
+  w.put32(data_count);
+}
+
+void PTR::restore_state(SnapshotReader &r)
+{
+  tty_file.close(); // The tape is not part of the snapshot
+  eot = r.get_bool();
+  eot_counter = r.get32();
+  mask = r.get16();
+  tape_running = r.get_bool();
+  ready = r.get_bool();
+  data_buf = r.get8();
+  ignore_event = r.get_bool();
+  events_queued = r.get32();
+  data_count = r.get32();
+}
+
 DEFINE_STD_NAME(PTR)
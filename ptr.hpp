@@ -42,6 +42,12 @@ namespace h16 {
 
     void dmc(unsigned dmc_dev, int16_t &data, bool erl);
 
+    void save_state(SnapshotWriter &w) const;
+    void restore_state(SnapshotReader &r);
+
+    bool set_turbo(bool on);
+    bool get_turbo() const { return turbo; }
+
     const char *name() const;
 
   private:
@@ -53,6 +59,8 @@ namespace h16 {
     void master_clear();
     void open_file();
     void start_reader();
+    bool read_character();
+    void next_character();
 
     TTY_file tty_file;
     std::string filename;
@@ -70,6 +78,8 @@ namespace h16 {
     int events_queued;
 
     int data_count;
+
+    bool turbo;
   };
 }
 #endif // _PTR_HPP_
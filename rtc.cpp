@@ -27,6 +27,7 @@
 #include "stdtty.hpp"
 
 #include "proc.hpp"
+#include "snapshot.hpp"
 
 #define SMK_MASK (1 << (16-16))
 
@@ -46,6 +47,7 @@ RTC::RTC(IoToPIntf &p)
 void RTC::master_clear()
 {
   interrupting = false;
+  running = false;
   mask = 0;
 };
 
@@ -130,4 +132,21 @@ DEFINE_UNEXPECTED_OTA(RTC)
 DEFINE_NULL_SET_FILENAME(RTC)
 DEFINE_UNEXPECTED_DMC(RTC)
 
+/*
+ * Snapshots
+ */
+void RTC::save_state(SnapshotWriter &w) const
+{
+  w.put16(mask);
+  w.put_bool(running);
+  w.put_bool(interrupting);
+}
+
+void RTC::restore_state(SnapshotReader &r)
+{
+  mask = r.get16();
+  running = r.get_bool();
+  interrupting = r.get_bool();
+}
+
 DEFINE_STD_NAME(RTC)
@@ -48,6 +48,9 @@ namespace h16 {
 
     void dmc(unsigned dmc_dev, int16_t &data, bool erl);
 
+    void save_state(SnapshotWriter &w) const;
+    void restore_state(SnapshotReader &r);
+
     const char *name() const;
   
   private:
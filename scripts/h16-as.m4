@@ -1,7 +1,11 @@
-ptr SLSTNAM
-g'1
+changequote([,])dnl
+dnl JOB leaves out loading DAP-16 (a job server has done it),
+dnl SETUP leaves out the assembly (it is the job server's setup)
+ifdef([JOB], [], [load SLSTNAM
 clear
-a CTRLNUM
+ptr_turbo on
+])dnl
+ifdef([SETUP], [], [a CTRLNUM
 ptr SRCNAM
 g'400
 ptr SRCNAM
@@ -9,3 +13,4 @@ ptp OBJNAM
 lpt LSTNAM
 g
 q
+])dnl
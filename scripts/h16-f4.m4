@@ -1,9 +1,14 @@
-ptr SLSTNAM
-g'1
+changequote([,])dnl
+dnl JOB leaves out loading FORTRAN (a job server has done it),
+dnl SETUP leaves out the compilation (it is the job server's setup)
+ifdef([JOB], [], [load SLSTNAM
 clear
-a'AREG
+ptr_turbo on
+])dnl
+ifdef([SETUP], [], [a'AREG
 ptr SRCNAM
 ptp OBJNAM
 lpt LSTNAM
 g'1000
 q
+])dnl
@@ -1,8 +1,13 @@
-ptr SLSTNAM
-g'1
+changequote([,])dnl
+dnl JOB leaves out loading MAC (a job server has done it),
+dnl SETUP leaves out the preprocessing (it is the job server's setup)
+ifdef([JOB], [], [load SLSTNAM
 clear
-a'000042
+ptr_turbo on
+])dnl
+ifdef([SETUP], [], [a'000042
 ptr SRCNAM
 ptp PRENAM
 g'1000
 q
+])dnl
@@ -0,0 +1,303 @@
+/* Honeywell Series 16 emulator
+ *
+ * Copyright (C) 2026  Adrian Wise
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA  02111-1307 USA
+ */
+
+#include "slst.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <format>
+
+using namespace h16;
+
+// Length of the loader, and offset of its halt from its start
+#define LOADER_LENGTH 0174
+#define LOADER_HALT 030
+
+bool SystemTape::get(int &c)
+{
+  if (pos >= tape.size()) {
+    error = "unexpected end of tape";
+    return false;
+  }
+  c = tape[pos++];
+  return true;
+}
+
+bool SystemTape::expect(int e)
+{
+  int c;
+
+  if (!get(c))
+    return false;
+
+  if (c != e) {
+    error = std::format("expected '{:03o} read '{:03o} at character {}", e, c, pos - 1);
+    return false;
+  }
+  return true;
+}
+
+bool SystemTape::skip_leader()
+{
+  while ((pos < tape.size()) && (tape[pos] == 0))
+    pos++;
+  return true;
+}
+
+bool SystemTape::read_8_8_block(std::vector<uint16_t> &words)
+{
+  int c1, c2;
+  uint16_t n;
+
+  skip_leader();
+
+  for (;;) {
+    if (!(get(c1) && get(c2)))
+      return false;
+    n = (c1 << 8) | c2;
+    if (n == 0)
+      return true;
+    words.push_back(n);
+  }
+}
+
+/*
+ * Channels 1-4 and 8 of a silent character are six bits of a word.
+ * Some codes are punched as others to keep clear of the ASR
+ * control characters.
+ */
+int SystemTape::translate(int c)
+{
+  int n;
+
+  switch (c & 0x7f) {
+  case 0177: n = 023 | (c & 0x80); break;
+  case 0176: n = 021 | (c & 0x80); break;
+  case 0175: n = 012 | (c & 0x80); break;
+  case 0174: n = 005 | (c & 0x80); break;
+  default: n = c;
+  }
+
+  if (n & 0x60)
+    return -1;
+
+  return ((n & 0x80) >> 2) | (n & 0x1f);
+}
+
+bool SystemTape::silent_char(int c, int &n)
+{
+  n = translate(c);
+  if (n < 0) {
+    error = std::format("channels 6 or 7 punched ('{:03o}) at character {}", c, pos - 1);
+    return false;
+  }
+  return true;
+}
+
+/*
+ * One word as three silent characters, or XOF. The top bit of the
+ * first character flags a run of zeros.
+ */
+bool SystemTape::read_silent(uint16_t &n, bool &zero_flag, bool &xof)
+{
+  int c, t;
+
+  if (!get(c))
+    return false;
+
+  xof = (c == 0223);
+  if (xof) {
+    n = 0;
+    return true;
+  }
+
+  zero_flag = (c & 0x80) != 0;
+  if (!silent_char(c & 0x7f, t))
+    return false;
+
+  if (t & 0x10) {
+    error = std::format("channel 5 punched in 4-bit character at character {}", pos - 1);
+    return false;
+  }
+  n = t << 12;
+
+  for (int shift = 6; shift >= 0; shift -= 6) {
+    if (!get(c))
+      return false;
+    if (c == 0223) {
+      error = std::format("XOF mid-word at character {}", pos - 1);
+      return false;
+    }
+    if (!silent_char(c, t))
+      return false;
+    n |= t << shift;
+  }
+
+  return true;
+}
+
+uint16_t SystemTape::checksum(uint16_t sum, uint16_t n)
+{
+  sum ^= n;
+  return ((sum & 1) << 15) | ((sum >> 1) & 0x7fff);
+}
+
+bool SystemTape::read_silent_block(int bc, bool &more)
+{
+  uint16_t addr, n;
+  bool zero_flag, xof;
+  uint16_t checksum = bc;
+  uint16_t old_checksum = checksum;
+  uint16_t wc = 0;
+  int c;
+
+  skip_leader();
+
+  if (!get(c))
+    return false;
+
+  more = (c != 0223);
+  if (!more)
+    return true;
+
+  while (c != 0201) {
+    if (!get(c))
+      return false;
+  }
+
+  if (!read_silent(addr, zero_flag, xof))
+    return false;
+  if (xof || zero_flag) {
+    error = std::format("bad address for block {}", bc);
+    return false;
+  }
+  checksum = SystemTape::checksum(checksum, addr);
+
+  Block block;
+  block.addr = addr + 1;
+
+  for (;;) {
+    if (!read_silent(n, zero_flag, xof))
+      return false;
+    if (xof)
+      break;
+
+    if (zero_flag) {
+      // n is minus the length of the run
+      for (uint16_t i = n; i != 0; i++) {
+        block.words.push_back(0);
+        wc++;
+      }
+    } else {
+      block.words.push_back(n);
+      wc++;
+    }
+    old_checksum = checksum;
+    checksum = SystemTape::checksum(checksum, n);
+  }
+
+  if (!expect(0377))
+    return false;
+
+  /*
+   * The last word is the checksum, of everything before it. The
+   * loader checks it rather than storing it.
+   */
+  if (block.words.empty() || (block.words.back() != (old_checksum ^ wc))) {
+    error = std::format("bad checksum in block {} at '{:06o}", bc, block.addr);
+    return false;
+  }
+  block.words.pop_back();
+
+  end_addr = block.addr + block.words.size();
+  blocks.push_back(std::move(block));
+  return true;
+}
+
+bool SystemTape::read(const std::string &filename)
+{
+  std::ifstream ifs(filename, std::ios::binary);
+
+  if (!ifs) {
+    std::cerr << std::format("Could not open <{}> for reading\n", filename);
+    return false;
+  }
+
+  tape.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+  pos = 0;
+  blocks.clear();
+  error.clear();
+
+  Block bootstrap, loader;
+  bool ok = true;
+
+  bootstrap.addr = 020;
+  ok = ok && skip_leader() && expect(020) && read_8_8_block(bootstrap.words);
+
+  if (ok && (bootstrap.words.size() <= (054 - 020))) {
+    error = "bootstrap too short";
+    ok = false;
+  }
+
+  /*
+   * The bootstrap reads the loader, straight after it, to two
+   * beyond the address it keeps in '54. Zero words are part of the
+   * loader here, and the last word is an XOF.
+   */
+  if (ok) {
+    loader.addr = loader_addr = bootstrap.words[054 - 020] + 2;
+    for (int i = 0; ok && (i < LOADER_LENGTH); i++) {
+      int c1, c2;
+      ok = get(c1) && get(c2);
+      loader.words.push_back((c1 << 8) | c2);
+    }
+    halt_addr = loader.addr + LOADER_HALT;
+  }
+
+  if (ok && (loader.words.back() != 0223)) {
+    error = "loader does not end in XOF";
+    ok = false;
+  }
+
+  ok = ok && expect(0377);
+
+  if (ok) {
+    blocks.push_back(std::move(bootstrap));
+    blocks.push_back(std::move(loader));
+  }
+
+  bool more = true;
+  for (int bc = 0; ok && more; bc++)
+    ok = read_silent_block(bc, more);
+
+  if (ok && (blocks.size() < 3)) {
+    error = "no program blocks";
+    ok = false;
+  }
+
+  if (!ok) {
+    std::cerr << std::format("<{}> is not a self-loading system tape: {}\n",
+                             filename, error);
+    blocks.clear();
+  }
+
+  return ok;
+}
@@ -0,0 +1,93 @@
+/* Honeywell Series 16 emulator
+ *
+ * Copyright (C) 2026  Adrian Wise
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA  02111-1307 USA
+ *
+ * Self-loading system tapes
+ *
+ * Decodes a PAL-AP style self-loading system tape on the host, as
+ * utils/h16-tape does, so that it can be put straight into core
+ * rather than read by the key-in loader through the emulated reader.
+ * The tape holds
+ *
+ *   leader, 020, the bootstrap as 8-8 words ending in a zero word
+ *   the loader, 0174 8-8 words ending in XOF (0223), then 0377
+ *   "silent" blocks: leader, 0201, address, data, checksum, XOF, 0377
+ *   leader, XOF
+ *
+ * Tapes with some other kind of loader are not understood and have
+ * to be read through the reader.
+ */
+
+#ifndef _SLST_HPP_
+#define _SLST_HPP_
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace h16 {
+
+  class SystemTape {
+  public:
+    struct Block {
+      uint16_t addr;
+      std::vector<uint16_t> words;
+    };
+
+    bool read(const std::string &filename);
+
+    const std::vector<Block> &get_blocks() const { return blocks; }
+
+    uint16_t get_loader_addr() const { return loader_addr; }
+
+    // Where the loader halts once the whole tape has been read
+    uint16_t get_halt_addr() const { return halt_addr; }
+
+    // Where the loader leaves X (where the last checksum was read to)
+    uint16_t get_end_addr() const { return end_addr; }
+
+    /*
+     * The silent character and checksum rules, also used by
+     * utils/h16-tape. translate() gives the six bits a character
+     * stands for, or -1 if channel 6 or 7 is punched; checksum()
+     * adds a word to a block's running checksum.
+     */
+    static int translate(int c);
+    static uint16_t checksum(uint16_t sum, uint16_t n);
+
+  private:
+    std::vector<uint8_t> tape;
+    size_t pos;
+    std::vector<Block> blocks;
+    uint16_t loader_addr;
+    uint16_t halt_addr;
+    uint16_t end_addr;
+    std::string error;
+
+    bool get(int &c);
+    bool expect(int c);
+    bool skip_leader();
+    bool read_8_8_block(std::vector<uint16_t> &words);
+    bool read_silent(uint16_t &n, bool &zero_flag, bool &xof);
+    bool silent_char(int c, int &n);
+    bool read_silent_block(int bc, bool &more);
+  };
+}
+
+#endif // _SLST_HPP_
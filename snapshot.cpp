@@ -0,0 +1,237 @@
+/* Honeywell Series 16 emulator
+ *
+ * Copyright (C) 2026  Adrian Wise
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA  02111-1307 USA
+ */
+
+#include "snapshot.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <format>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace h16;
+
+/*****************************************************************
+ * SnapshotWriter
+ *****************************************************************/
+
+SnapshotWriter::SnapshotWriter()
+{
+  buffer.assign(SnapshotFormat::MAGIC,
+                SnapshotFormat::MAGIC + sizeof(SnapshotFormat::MAGIC));
+  put32(SnapshotFormat::FORMAT_VERSION);
+}
+
+void SnapshotWriter::begin(const char tag[4])
+{
+  for (int i=0; i<4; i++)
+    put8(tag[i]);
+  put32(0); // length, filled in by end()
+  starts.push_back(buffer.size());
+}
+
+void SnapshotWriter::end()
+{
+  const size_t start = starts.back();
+  const uint32_t length = buffer.size() - start;
+
+  starts.pop_back();
+  for (int i=0; i<4; i++)
+    buffer[start - 4 + i] = (length >> (8 * i)) & 0xff;
+}
+
+void SnapshotWriter::put_string(const std::string &s)
+{
+  put32(s.size());
+  buffer.insert(buffer.end(), s.begin(), s.end());
+}
+
+bool SnapshotWriter::write(const std::string &filename)
+{
+  FILE *fp = fopen(filename.c_str(), "wb");
+  if (!fp) {
+    std::cerr << std::format("Could not open <{}> for writing\n", filename);
+    return false;
+  }
+
+  bool ok = (fwrite(buffer.data(), 1, buffer.size(), fp) == buffer.size());
+  ok = (fclose(fp) == 0) && ok;
+
+  if (!ok) {
+    std::cerr << std::format("Error writing snapshot file <{}>\n", filename);
+  }
+
+  return ok;
+}
+
+/*****************************************************************
+ * SnapshotReader
+ *****************************************************************/
+
+SnapshotReader::SnapshotReader()
+  : data(nullptr)
+  , size(0)
+  , pos(0)
+  , good(false)
+{
+}
+
+SnapshotReader::~SnapshotReader()
+{
+  close();
+}
+
+bool SnapshotReader::open(const std::string &filename)
+{
+  struct stat st;
+
+  close();
+
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cerr << std::format("Could not open <{}> for reading\n", filename);
+    return false;
+  }
+
+  void *p = MAP_FAILED;
+  if ((fstat(fd, &st) == 0) && (st.st_size > 0)) {
+    size = st.st_size;
+    p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  ::close(fd);
+
+  if (p == MAP_FAILED) {
+    std::cerr << std::format("Could not read <{}>\n", filename);
+    size = 0;
+    return false;
+  }
+
+  data = static_cast<const uint8_t *>(p);
+  pos = 0;
+  ends.clear();
+  good = true;
+
+  const size_t header = sizeof(SnapshotFormat::MAGIC) + 4;
+  if ((size < header) ||
+      (memcmp(data, SnapshotFormat::MAGIC, sizeof(SnapshotFormat::MAGIC)) != 0)) {
+    std::cerr << std::format("<{}> is not an h16 snapshot file\n", filename);
+    close();
+    return false;
+  }
+
+  pos = sizeof(SnapshotFormat::MAGIC);
+  uint32_t version = get32();
+  if (version != SnapshotFormat::FORMAT_VERSION) {
+    std::cerr << std::format("<{}> is a version {} snapshot, expected version {}\n",
+                             filename, version, SnapshotFormat::FORMAT_VERSION);
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+bool SnapshotReader::rewind()
+{
+  if (!data)
+    return false;
+
+  pos = sizeof(SnapshotFormat::MAGIC) + 4;
+  ends.clear();
+  good = true;
+
+  return true;
+}
+
+void SnapshotReader::close()
+{
+  if (data) {
+    munmap(const_cast<uint8_t *>(data), size);
+  }
+  data = nullptr;
+  size = 0;
+  pos = 0;
+  ends.clear();
+  good = false;
+}
+
+bool SnapshotReader::next_is(const char tag[4])
+{
+  return good && ((pos + 8) <= limit()) && (memcmp(data + pos, tag, 4) == 0);
+}
+
+/*
+ * Enter the next section, which must have the given tag
+ */
+bool SnapshotReader::begin(const char tag[4])
+{
+  if (!next_is(tag)) {
+    good = false;
+    return false;
+  }
+
+  pos += 4;
+  const size_t length = get32();
+  if ((pos + length) > limit()) {
+    good = false;
+    return false;
+  }
+
+  ends.push_back(pos + length);
+  return true;
+}
+
+/*
+ * Leave the current section, skipping anything not read
+ */
+void SnapshotReader::end()
+{
+  if (!ends.empty()) {
+    pos = ends.back();
+    ends.pop_back();
+  }
+}
+
+uint8_t SnapshotReader::get8()
+{
+  if (pos >= limit()) {
+    good = false;
+    return 0;
+  }
+  return data[pos++];
+}
+
+std::string SnapshotReader::get_string()
+{
+  const size_t length = get32();
+
+  if (!good || ((pos + length) > limit())) {
+    good = false;
+    return std::string();
+  }
+
+  std::string s(reinterpret_cast<const char *>(data + pos), length);
+  pos += length;
+  return s;
+}
@@ -0,0 +1,116 @@
+/* Honeywell Series 16 emulator
+ *
+ * Copyright (C) 2026  Adrian Wise
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA  02111-1307 USA
+ *
+ * Machine snapshot files
+ *
+ * The file starts with the 8 byte magic "H16SNP01" and a 4 byte
+ * format version, followed by a sequence of sections:
+ *
+ *   tag      4 bytes, e.g. "CPU "
+ *   length   4 bytes, size of the body
+ *   body     written and read field by field by the owner
+ *
+ * All numbers are little-endian. Each owner reads back what it
+ * wrote; whatever it leaves unread at the end of its section is
+ * skipped, so a section may grow at the end without breaking
+ * older readers. Anything else changes FORMAT_VERSION.
+ */
+
+#ifndef _SNAPSHOT_HPP_
+#define _SNAPSHOT_HPP_
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace h16 {
+
+  struct SnapshotFormat {
+    static constexpr char MAGIC[8] = {'H','1','6','S','N','P','0','1'};
+    static const uint32_t FORMAT_VERSION = 1;
+  };
+
+  class SnapshotWriter {
+  public:
+    SnapshotWriter();
+
+    void begin(const char tag[4]);
+    void end();
+
+    void put8(uint8_t v) { buffer.push_back(v); }
+    void put16(uint16_t v) { put8(v & 0xff); put8(v >> 8); }
+    void put32(uint32_t v) { put16(v & 0xffff); put16(v >> 16); }
+    void put64(uint64_t v) { put32(v & 0xffffffff); put32(v >> 32); }
+    void put_bool(bool v) { put8(v ? 1 : 0); }
+    void put_string(const std::string &s);
+
+    bool write(const std::string &filename);
+
+    // Bytes written so far
+    size_t size() const { return buffer.size(); }
+
+  private:
+    std::vector<uint8_t> buffer;
+    std::vector<size_t> starts; // of the open sections' bodies
+  };
+
+  /*
+   * Reads a snapshot file, mapped into memory
+   */
+  class SnapshotReader {
+  public:
+    SnapshotReader();
+    ~SnapshotReader();
+
+    bool open(const std::string &filename);
+    void close();
+
+    // Back to the first section
+    bool rewind();
+
+    bool next_is(const char tag[4]);
+    bool begin(const char tag[4]);
+    void end();
+
+    uint8_t get8();
+    uint16_t get16() { uint16_t v = get8(); return v | (get8() << 8); }
+    uint32_t get32() { uint32_t v = get16(); return v | (uint32_t(get16()) << 16); }
+    uint64_t get64() { uint64_t v = get32(); return v | (uint64_t(get32()) << 32); }
+    bool get_bool() { return get8() != 0; }
+    std::string get_string();
+
+    // Bytes not yet read in the current section
+    size_t left() const { return limit() - pos; }
+
+    // False once anything has been read past the end of a section
+    bool ok() const { return good; }
+
+  private:
+    const uint8_t *data;
+    size_t size;
+    size_t pos;
+    std::vector<size_t> ends; // of the open sections
+    bool good;
+
+    size_t limit() const { return ends.empty() ? size : ends.back(); }
+  };
+}
+
+#endif // _SNAPSHOT_HPP_
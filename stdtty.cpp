@@ -30,6 +30,9 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#ifdef HAVE_POLL_H
+#include <poll.h>
+#endif
 #ifdef HAVE_READLINE_READLINE_H
 #include <readline/readline.h>
 #endif
@@ -442,6 +445,28 @@ void StdTty::service_tty_input()
   }
 }
 
+/*
+ * Block until there is terminal input, or for at most timeout_ms,
+ * for when the emulated machine can do nothing until there is
+ * (see Proc::StopReason::WAIT). Without poll() just return, and
+ * the machine will spin as it always did.
+ */
+void StdTty::wait_for_input(int timeout_ms)
+{
+#ifdef HAVE_POLL_H
+  if ((!canonical) && isatty(STDIN_FILENO)) {
+    struct pollfd pfd;
+
+    pfd.fd = STDIN_FILENO;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    if (poll(&pfd, 1, timeout_ms) > 0)
+      tty_input = true; // In case SIGIO has not said so yet
+  }
+#endif
+}
+
 bool StdTty::special_action(char c)
 {
   bool r = false;
@@ -56,6 +56,15 @@ namespace h16 {
       }
     }
 
+    static void wait(int timeout_ms) {
+      if (!pStdTty) {
+        (void) getInstance();
+      }
+      if (pStdTty) {
+        pStdTty->wait_for_input(timeout_ms);
+      }
+    }
+
     void register_callback(void *p, bool (*call_back)(void *p, int k));
   
     bool got_char(char &c);
@@ -72,6 +81,7 @@ namespace h16 {
     };
     bool get_tty_input(){return tty_input;};
     void service_tty_input();
+    void wait_for_input(int timeout_ms);
 
   private:
     struct SavedState *savedState;
@@ -11,9 +11,10 @@ INSTALLDIR="${INSTALLATION:-install}"
 run_vt()
 {
   name=$1
+  shift
   rm -f logfile.txt ${name}_actual.txt
   res=${jshuERROR}
-  ${workspace}/${INSTALLDIR}/bin/h16 -t ${name}.txt |& tee logfile.txt
+  ${workspace}/${INSTALLDIR}/bin/h16 -t "$@" ${name}.txt |& tee logfile.txt
   if diff logfile.txt ${name}_expected.txt; then
       res=${jshuPASS}
   else
@@ -49,6 +50,100 @@ x16_08t1_Test()
   return $?
 }
 
+# X16-08T1 again, put straight into core rather than read by
+# its bootstrap
+
+x16_08t1_load_Test()
+{
+  run_vt x16_08t1_load
+  return $?
+}
+
+# O16-11T1 again, read with the paper-tape reader in turbo mode
+
+o16_11t1_turbo_Test()
+{
+  run_vt o16_11t1_turbo
+  return $?
+}
+
+# X16-08T1 stopped by a breakpoint and watchpoints on the way
+
+x16_08t1_break_Test()
+{
+  run_vt x16_08t1_break
+  return $?
+}
+
+# X16-08T1 with the execution profile on
+
+x16_08t1_profile_Test()
+{
+  run_vt x16_08t1_profile
+  return $?
+}
+
+# X16-08T1 with the call graph on
+
+x16_08t1_calls_Test()
+{
+  run_vt x16_08t1_calls
+  return $?
+}
+
+# DMC and interrupts from the VDMC verification device
+
+vdmc_Test()
+{
+  run_vt vdmc
+  return $?
+}
+
+# The same again with the BLOCK engine, which must give
+# exactly the same results
+
+ab16_cct4_block_Test()
+{
+  run_vt ab16_cct4 -E block
+  return $?
+}
+
+o16_11t1_block_Test()
+{
+  run_vt o16_11t1 -E block
+  return $?
+}
+
+ab16_cmt5_block_Test()
+{
+  run_vt ab16_cmt5 -E block
+  return $?
+}
+
+x16_08t1_block_Test()
+{
+  run_vt x16_08t1 -E block
+  return $?
+}
+
+vdmc_block_Test()
+{
+  run_vt vdmc -E block
+  return $?
+}
+
+x16_08t1_break_block_Test()
+{
+  run_vt x16_08t1_break -E block
+  return $?
+}
+
+x16_08t1_profile_block_Test()
+{
+  run_vt x16_08t1_profile -E block
+  return $?
+}
+
 ##############################################################
 # main
 ##############################################################
@@ -0,0 +1,243 @@
+/* Honeywell Series 16 emulator
+ *
+ * Copyright (C) 2026  Adrian Wise
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA  02111-1307 USA
+ */
+
+#include "trace_writer.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <format>
+
+using namespace h16;
+
+/*****************************************************************
+ * TraceWriter
+ *****************************************************************/
+
+TraceWriter::TraceWriter()
+  : fp(nullptr)
+  , active(0)
+  , fill(0)
+  , prev()
+  , pending(false)
+  , pending_size(0)
+  , stopping(false)
+  , write_error(false)
+{
+}
+
+TraceWriter::~TraceWriter()
+{
+  (void) close();
+}
+
+bool TraceWriter::open(const std::string &filename)
+{
+  (void) close();
+
+  fp = fopen(filename.c_str(), "wb");
+  if (!fp) {
+    std::cerr << std::format("Could not open <{}> for writing\n", filename);
+    return false;
+  }
+
+  this->filename = filename;
+  for (auto &b: buffers) {
+    b.resize(BUFFER_SIZE);
+  }
+
+  memcpy(buffers[0].data(), TraceFormat::MAGIC, sizeof(TraceFormat::MAGIC));
+  active = 0;
+  fill = sizeof(TraceFormat::MAGIC);
+  prev = TraceRecord();
+  pending = false;
+  stopping = false;
+  write_error = false;
+
+  writer = std::thread(&TraceWriter::write_buffers, this);
+
+  return true;
+}
+
+/*
+ * Flush whatever has been recorded, stop the writer thread
+ * and close the file. Returns false if anything failed to
+ * be written.
+ */
+bool TraceWriter::close()
+{
+  if (!fp)
+    return true;
+
+  swap_buffers();
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  cv.notify_all();
+  writer.join();
+
+  if (fclose(fp) != 0)
+    write_error = true;
+  fp = nullptr;
+
+  for (auto &b: buffers) {
+    b.clear();
+    b.shrink_to_fit();
+  }
+
+  if (write_error) {
+    std::cerr << std::format("Error writing trace file <{}>\n", filename);
+  }
+
+  return !write_error;
+}
+
+/*
+ * Hand the active buffer to the writer thread and carry on
+ * with the other one, first waiting for the writer to finish
+ * with it if necessary.
+ */
+void TraceWriter::swap_buffers()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  cv.wait(lock, [this]{ return !pending; });
+
+  pending = true;
+  pending_size = fill;
+  active ^= 1;
+  fill = 0;
+
+  lock.unlock();
+  cv.notify_all();
+}
+
+void TraceWriter::write_buffers()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+
+  for (;;) {
+    cv.wait(lock, [this]{ return pending || stopping; });
+
+    if (pending) {
+      const std::vector<uint8_t> &b(buffers[active ^ 1]);
+      size_t size = pending_size;
+
+      lock.unlock();
+      bool ok = (fwrite(b.data(), 1, size, fp) == size);
+      lock.lock();
+
+      if (!ok)
+        write_error = true;
+      pending = false;
+      cv.notify_all();
+    } else {
+      break; // stopping, and nothing left to write
+    }
+  }
+}
+
+/*****************************************************************
+ * TraceReader
+ *****************************************************************/
+
+TraceReader::TraceReader()
+  : fp(nullptr)
+  , prev()
+{
+}
+
+TraceReader::~TraceReader()
+{
+  if (fp)
+    fclose(fp);
+}
+
+bool TraceReader::open(const std::string &filename)
+{
+  char magic[sizeof(TraceFormat::MAGIC)];
+
+  fp = fopen(filename.c_str(), "rb");
+  if (!fp) {
+    std::cerr << std::format("Could not open <{}> for reading\n", filename);
+    return false;
+  }
+
+  if ((fread(magic, 1, sizeof(magic), fp) != sizeof(magic)) ||
+      (memcmp(magic, TraceFormat::MAGIC, sizeof(magic)) != 0)) {
+    std::cerr << std::format("<{}> is not an h16 trace file\n", filename);
+    fclose(fp);
+    fp = nullptr;
+    return false;
+  }
+
+  prev = TraceRecord();
+  return true;
+}
+
+bool TraceReader::get16(uint16_t &v)
+{
+  int lo = getc(fp);
+  int hi = getc(fp);
+  v = (lo & 0xff) | ((hi & 0xff) << 8);
+  return (hi != EOF);
+}
+
+/*
+ * Read the next record; returns false at the end of the file
+ * (or if the last record was truncated or corrupt)
+ */
+bool TraceReader::next(TraceRecord &r)
+{
+  int flags = getc(fp);
+  if (flags == EOF)
+    return false;
+
+  uint64_t delta = 0;
+  unsigned shift = 0;
+  int c;
+  do {
+    c = getc(fp);
+    if ((c == EOF) || (shift >= 64))
+      return false;
+    delta |= uint64_t(c & 0x7f) << shift;
+    shift += 7;
+  } while (c & 0x80);
+
+  r = prev;
+  r.half_cycles += delta;
+
+  bool ok = get16(r.instr);
+
+  if (flags & TraceFormat::F_PSEQ)
+    r.p = prev.p + 1;
+  else
+    ok = ok && get16(r.p);
+
+  if (flags & TraceFormat::F_A) ok = ok && get16(r.a);
+  if (flags & TraceFormat::F_B) ok = ok && get16(r.b);
+  if (flags & TraceFormat::F_X) ok = ok && get16(r.x);
+  if (flags & TraceFormat::F_Y) ok = ok && get16(r.y);
+  r.c   = (flags & TraceFormat::F_C) != 0;
+  r.brk = (flags & TraceFormat::F_BRK) != 0;
+
+  prev = r;
+  return ok;
+}
@@ -0,0 +1,170 @@
+/* Honeywell Series 16 emulator
+ *
+ * Copyright (C) 2026  Adrian Wise
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA  02111-1307 USA
+ *
+ * Streaming binary instruction trace
+ *
+ * The file starts with the 8 byte magic "H16TRC01" followed by one
+ * record per instruction (or break). Each record is delta-encoded
+ * against the previous one:
+ *
+ *   flags    1 byte, F_* bits below
+ *   delta    unsigned LEB128, half_cycles minus previous half_cycles
+ *   instr    2 bytes
+ *   p        2 bytes, unless F_PSEQ (p is previous p + 1)
+ *   a, b, x  2 bytes each, only if F_A, F_B, F_X (changed)
+ *   y        2 bytes, only if F_Y (changed)
+ *
+ * All 16-bit fields are little-endian. The fields have the same
+ * meanings as in the in-memory trace (CPU::Btrace), including the
+ * use of p, y and c for the data, address and ERL of a DMC break.
+ */
+
+#ifndef _TRACE_WRITER_HPP_
+#define _TRACE_WRITER_HPP_
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace h16 {
+
+  struct TraceRecord {
+    uint64_t half_cycles;
+    uint16_t a, b, x;
+    bool c;
+    uint16_t p, instr, y;
+    bool brk;
+  };
+
+  struct TraceFormat {
+    static constexpr char MAGIC[8] = {'H','1','6','T','R','C','0','1'};
+
+    static const uint8_t F_A    = 0x01;
+    static const uint8_t F_B    = 0x02;
+    static const uint8_t F_X    = 0x04;
+    static const uint8_t F_Y    = 0x08;
+    static const uint8_t F_PSEQ = 0x10;
+    static const uint8_t F_C    = 0x20; // value of C
+    static const uint8_t F_BRK  = 0x40; // value of brk
+
+    static const unsigned MAX_RECORD = 1 + 10 + (2 * 6);
+  };
+
+  /*
+   * Records are encoded into one of two buffers by the emulator
+   * thread; when a buffer fills it is handed to a background
+   * thread to be written while the other is filled.
+   */
+  class TraceWriter {
+  public:
+    TraceWriter();
+    ~TraceWriter();
+
+    bool open(const std::string &filename);
+    bool close();
+    bool is_open() const { return fp != nullptr; }
+
+    void record(const TraceRecord &r)
+    {
+      if (fill > (BUFFER_SIZE - TraceFormat::MAX_RECORD))
+        swap_buffers();
+
+      uint8_t *q = buffers[active].data() + fill;
+      uint8_t *fp_flags = q++;
+      uint8_t flags = 0;
+
+      uint64_t delta = r.half_cycles - prev.half_cycles;
+      while (delta >= 0x80) {
+        *q++ = (delta & 0x7f) | 0x80;
+        delta >>= 7;
+      }
+      *q++ = delta;
+
+      put16(q, r.instr);
+
+      if (r.p == uint16_t(prev.p + 1))
+        flags |= TraceFormat::F_PSEQ;
+      else
+        put16(q, r.p);
+
+      if (r.a != prev.a) { flags |= TraceFormat::F_A; put16(q, r.a); }
+      if (r.b != prev.b) { flags |= TraceFormat::F_B; put16(q, r.b); }
+      if (r.x != prev.x) { flags |= TraceFormat::F_X; put16(q, r.x); }
+      if (r.y != prev.y) { flags |= TraceFormat::F_Y; put16(q, r.y); }
+      if (r.c)           flags |= TraceFormat::F_C;
+      if (r.brk)         flags |= TraceFormat::F_BRK;
+
+      *fp_flags = flags;
+      fill = q - buffers[active].data();
+      prev = r;
+    }
+
+  private:
+    static const size_t BUFFER_SIZE = 1 << 20;
+
+    FILE *fp;
+    std::string filename;
+
+    std::vector<uint8_t> buffers[2];
+    unsigned active;
+    size_t fill;
+    TraceRecord prev;
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool pending;      // buffers[active ^ 1] is waiting to be written
+    size_t pending_size;
+    bool stopping;
+    bool write_error;
+
+    static void put16(uint8_t *&q, uint16_t v)
+    {
+      *q++ = v & 0xff;
+      *q++ = v >> 8;
+    }
+
+    void swap_buffers();
+    void write_buffers();
+  };
+
+  /*
+   * Reads back a file written by TraceWriter
+   */
+  class TraceReader {
+  public:
+    TraceReader();
+    ~TraceReader();
+
+    bool open(const std::string &filename);
+    bool next(TraceRecord &r);
+
+  private:
+    FILE *fp;
+    TraceRecord prev;
+
+    bool get16(uint16_t &v);
+  };
+}
+
+#endif // _TRACE_WRITER_HPP_
@@ -32,6 +32,7 @@
 #include <map>
 
 #include "instr.hpp"
+#include "slst.hpp"
 
 using namespace h16;
 
@@ -178,24 +179,14 @@ static int translate(int c, bool &xof)
       //exit(1);
     }
 
-   switch(c & 0x7f)
-    {
-    case 0177: n = 023 | (c & 0x80); break;
-    case 0176: n = 021 | (c & 0x80); break;
-    case 0175: n = 012 | (c & 0x80); break;
-    case 0174: n = 005 | (c & 0x80); break;
-    default: n = c;
-    }
+  n = SystemTape::translate(c);
 
-  if (n & 0x60)
+  if (n < 0)
     {
-      fprintf(stderr, "Channels 6 or 7 punched (%03o)\n", n);
+      fprintf(stderr, "Channels 6 or 7 punched (%03o)\n", c);
       exit(1);
     }
 
-  n = ((n&0x80)>>2) | (n & 0x1f);
-  /*printf("translate %03o to %03o\n", c, n);*/
-
   return n;
 }
 
@@ -270,9 +261,7 @@ static int read_silent_block(FILE *fp, int find_start,
 
   addr = read_silent(fp, zero_flag, xof);
 
-  checksum ^= addr;
-  checksum = ((checksum & 1) << 15) |
-    ((checksum >> 1) & 0x7fff);
+  checksum = SystemTape::checksum(checksum, addr);
   addr++;
   a = addr;
 
@@ -303,9 +292,7 @@ static int read_silent_block(FILE *fp, int find_start,
           wc++;
         }
       old_checksum = checksum;
-      checksum ^= n;
-      checksum = ((checksum & 1) << 15) |
-        ((checksum >> 1) & 0x7fff);
+      checksum = SystemTape::checksum(checksum, n);
       
       n = read_silent(fp, zero_flag, xof);
     }
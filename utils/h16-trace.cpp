@@ -0,0 +1,175 @@
+/* Honeywell Series 16 emulator
+ * Copyright (C) 2026  Adrian Wise
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA  02111-1307 USA
+ *
+ * Decode a binary trace file written by "h16 -S" (or the
+ * monitor "tfile" command) in the same format as the monitor
+ * "trace" command.
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+#include <iostream>
+#include <string>
+#include <format>
+
+#include "instr.hpp"
+#include "trace_writer.hpp"
+
+using namespace h16;
+
+static InstrTable instr_table;
+
+static void usage(const char *name)
+{
+  fprintf(stderr,
+          "usage: %s [-a first,last] [-c classes] [-t start,end] <filename>\n"
+          "  -a first,last : only instructions at addresses first to last\n"
+          "  -c classes    : only these instruction classes, comma separated\n"
+          "                  from MR, GA, GB, SH, SK and IO\n"
+          "  -t start,end  : only between half-cycles start and end\n"
+          "  Numbers are C-style (e.g. 01000 for octal)\n",
+          name);
+  exit(1);
+}
+
+static bool parse_range(const char *s, uint64_t &first, uint64_t &last)
+{
+  char *end;
+
+  first = strtoull(s, &end, 0);
+  if (*end != ',')
+    return false;
+  last = strtoull(end+1, &end, 0);
+  return (*end == '\0') && (first <= last);
+}
+
+static bool parse_classes(const char *s, unsigned &classes)
+{
+  static const struct {
+    const char *name;
+    unsigned mask;
+  } names[] = {
+    {"MR", 1u << InstrTable::Instr::MR},
+    {"GA", 1u << InstrTable::Instr::GA},
+    {"GB", 1u << InstrTable::Instr::GB},
+    {"SH", 1u << InstrTable::Instr::SH},
+    {"SK", 1u << InstrTable::Instr::SK},
+    {"IO", (1u << InstrTable::Instr::IO) | (1u << InstrTable::Instr::IG)},
+  };
+
+  std::string str(s);
+  size_t pos = 0;
+
+  classes = 0;
+  while (pos <= str.size()) {
+    size_t comma = str.find(',', pos);
+    if (comma == std::string::npos)
+      comma = str.size();
+    std::string word = str.substr(pos, comma - pos);
+
+    bool found = false;
+    for (auto &n: names) {
+      if (word == n.name) {
+        classes |= n.mask;
+        found = true;
+      }
+    }
+    if (!found)
+      return false;
+
+    pos = comma + 1;
+  }
+
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  int a = 1;
+  bool parsing_args = true;
+
+  bool addr_filter = false;
+  uint64_t first_addr = 0, last_addr = 0;
+  unsigned classes = 0; // 0 means all
+  uint64_t start = 0, end = UINT64_MAX;
+
+  while (parsing_args && (a < (argc-1))) {
+    if ((strcmp(argv[a], "-a")==0) && (a < (argc-2))) {
+      if (!parse_range(argv[a+1], first_addr, last_addr))
+        usage(argv[0]);
+      addr_filter = true;
+      a += 2;
+    } else if ((strcmp(argv[a], "-c")==0) && (a < (argc-2))) {
+      if (!parse_classes(argv[a+1], classes))
+        usage(argv[0]);
+      a += 2;
+    } else if ((strcmp(argv[a], "-t")==0) && (a < (argc-2))) {
+      if (!parse_range(argv[a+1], start, end))
+        usage(argv[0]);
+      a += 2;
+    } else {
+      parsing_args = false;
+    }
+  }
+
+  if (a != (argc-1))
+    usage(argv[0]);
+
+  TraceReader reader;
+  if (!reader.open(argv[a]))
+    exit(1);
+
+  TraceRecord r;
+  while (reader.next(r)) {
+
+    if ((r.half_cycles < start) || (r.half_cycles > end))
+      continue;
+
+    bool dmc = r.brk && (r.instr < 16);
+
+    if (addr_filter &&
+        (r.brk || (r.p < first_addr) || (r.p > last_addr)))
+      continue;
+
+    if (classes &&
+        (r.brk || !(classes & (1u << instr_table.type(r.instr)))))
+      continue;
+
+    if (dmc) {
+      bool dmc_wrt = ((r.y & 0x8000) != 0);
+
+      std::cout << std::format("{:0>10d}: {} {:0>6o} {} {:0>5o} {} {}\n",
+                               r.half_cycles,
+                               ((dmc_wrt) ? "Write" : "Read"), r.p,
+                               ((dmc_wrt) ? "to " : "from"), (r.y & 0x7fff),
+                               ((r.c) ? "ERL" : "   "),
+                               instr_table.disassemble(r.p, r.instr, r.brk,
+                                                       r.y, true));
+    } else {
+      std::cout << std::format("{:0>10d}: A:{:0>6o} B:{:0>6o} X:{:0>6o} C:{:1d} {}\n",
+                               r.half_cycles, r.a, r.b, r.x, (r.c ? 1 : 0),
+                               instr_table.disassemble(r.p, r.instr, r.brk,
+                                                       r.y, true));
+    }
+  }
+
+  exit(0);
+}